@@ -0,0 +1,15 @@
+﻿using System;
+
+namespace X264NetHost
+{
+	/// <summary>
+	/// The host process for x264net.RemoteEncoder.  RemoteEncoder starts this program with the name of the shared memory holding its frames; it is not meant to be run by hand.
+	/// </summary>
+	class Program
+	{
+		static int Main(string[] args)
+		{
+			return x264net.EncoderHost.Run(args);
+		}
+	}
+}
@@ -0,0 +1,202 @@
+#include "BitrateMultiplexer.h"
+#include "x264net.h"
+namespace x264net
+{
+	MultiplexMember::MultiplexMember(BitrateMultiplexer^ multiplexer, X264Net^ encoder) : multiplexer(multiplexer), encoder(encoder)
+	{
+		X264Options^ options = encoder->Options;
+		referenceQuality = options->Pass == 0 && !options->ConstantBitRate ? options->Quality : 0;
+		frameRate = (double)options->FPS / options->FPSDenominator;
+		windowFrames = Math::Max(1.0, frameRate * options->BitRateSmoothOverSeconds);
+		demand = 0;
+		hasDemand = false;
+		allocation = options->MaxBitRate;
+		applied = options->MaxBitRate;
+	}
+	/// <summary>
+	/// <para>Records the size and effective rate factor of a frame the encoder just output, and returns its allocation, which the encoder applies before its next frame.</para>
+	/// </summary>
+	int MultiplexMember::Report(int frameSize, double rateFactor)
+	{
+		return multiplexer->Report(this, frameSize, rateFactor);
+	}
+
+	BitrateMultiplexer::BitrateMultiplexer(int totalBitRate)
+	{
+		if (totalBitRate < 1)
+			throw gcnew Exception("totalBitRate must be at least 1. Provided value: " + totalBitRate);
+		members = gcnew List<MultiplexMember^>();
+		this->totalBitRate = totalBitRate;
+		minimumShare = 0.25;
+	}
+	int BitrateMultiplexer::TotalBitRate::get()
+	{
+		return totalBitRate;
+	}
+	void BitrateMultiplexer::TotalBitRate::set(int value)
+	{
+		if (value < 1)
+			throw gcnew Exception("TotalBitRate must be at least 1. Provided value: " + value);
+		System::Threading::Monitor::Enter(members);
+		try
+		{
+			if (value < members->Count)
+				throw gcnew ArgumentException("TotalBitRate must be at least 1 kbps per member (" + members->Count + "). Provided value: " + value);
+			totalBitRate = value;
+			Rebalance();
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(members);
+		}
+	}
+	double BitrateMultiplexer::MinimumShare::get()
+	{
+		return minimumShare;
+	}
+	void BitrateMultiplexer::MinimumShare::set(double value)
+	{
+		if (!(value >= 0 && value <= 1))
+			throw gcnew Exception("MinimumShare must be between 0 and 1. Provided value: " + value);
+		System::Threading::Monitor::Enter(members);
+		try
+		{
+			minimumShare = value;
+			Rebalance();
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(members);
+		}
+	}
+	int BitrateMultiplexer::MemberCount::get()
+	{
+		System::Threading::Monitor::Enter(members);
+		try
+		{
+			return members->Count;
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(members);
+		}
+	}
+	void BitrateMultiplexer::Join(X264Net^ encoder)
+	{
+		if (encoder == nullptr)
+			throw gcnew ArgumentNullException("encoder");
+		if (encoder->Options->MaxBitRate <= 0)
+			throw gcnew ArgumentException("The encoder must be created with a MaxBitRate, so that x264 enables the VBV the multiplexer retunes.", "encoder");
+		if (encoder->Options->Pass > 0)
+			throw gcnew ArgumentException("Multi-pass encoders cannot join a multiplexer.", "encoder");
+		System::Threading::Monitor::Enter(members);
+		try
+		{
+			if (members->Count >= totalBitRate)
+				throw gcnew InvalidOperationException("TotalBitRate (" + totalBitRate + ") cannot give every member at least 1 kbps if another joins");
+			// Another multiplexer may be joining the same encoder under its own lock, so claim the encoder atomically.
+			MultiplexMember^ member = gcnew MultiplexMember(this, encoder);
+			if (System::Threading::Interlocked::CompareExchange<MultiplexMember^>(encoder->multiplexMember, member, nullptr) != nullptr)
+				throw gcnew InvalidOperationException("The encoder already belongs to a multiplexer");
+			members->Add(member);
+			Rebalance();
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(members);
+		}
+	}
+	void BitrateMultiplexer::Leave(X264Net^ encoder)
+	{
+		if (encoder == nullptr)
+			throw gcnew ArgumentNullException("encoder");
+		System::Threading::Monitor::Enter(members);
+		try
+		{
+			MultiplexMember^ member = encoder->multiplexMember;
+			if (member == nullptr || member->multiplexer != this)
+				return;
+			members->Remove(member);
+			System::Threading::Interlocked::CompareExchange<MultiplexMember^>(encoder->multiplexMember, nullptr, member);
+			Rebalance();
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(members);
+		}
+	}
+	int BitrateMultiplexer::GetAllocatedBitRate(X264Net^ encoder)
+	{
+		if (encoder == nullptr)
+			throw gcnew ArgumentNullException("encoder");
+		System::Threading::Monitor::Enter(members);
+		try
+		{
+			MultiplexMember^ member = encoder->multiplexMember;
+			return member != nullptr && member->multiplexer == this ? member->allocation : 0;
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(members);
+		}
+	}
+	int BitrateMultiplexer::Report(MultiplexMember^ member, int frameSize, double rateFactor)
+	{
+		// A frame that needed a higher (worse) rate factor than the encoder aims for would have needed about 2^(difference / 6) times the bits to reach it.
+		double bits = frameSize * 8.0;
+		if (member->referenceQuality > 0 && rateFactor > 0)
+			bits *= Math::Pow(2.0, (rateFactor - member->referenceQuality) / 6.0);
+		double kbps = bits * member->frameRate / 1000;
+		System::Threading::Monitor::Enter(members);
+		try
+		{
+			if (member->hasDemand)
+				member->demand += (kbps - member->demand) / member->windowFrames;
+			else
+			{
+				member->demand = kbps;
+				member->hasDemand = true;
+			}
+			Rebalance();
+			return member->allocation;
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(members);
+		}
+	}
+	/// <summary>
+	/// <para>Splits the budget among the members.  Must be called with the lock held.</para>
+	/// </summary>
+	void BitrateMultiplexer::Rebalance()
+	{
+		int count = members->Count;
+		if (count == 0)
+			return;
+		// Members that have not output a frame yet are assumed to need as much as the average member.
+		double known = 0;
+		int knownCount = 0;
+		for each (MultiplexMember^ member in members)
+		{
+			if (member->hasDemand)
+			{
+				known += member->demand;
+				knownCount++;
+			}
+		}
+		double assumed = knownCount > 0 ? known / knownCount : 1;
+		double totalDemand = known + assumed * (count - knownCount);
+
+		// Every member gets at least 1 kbps, and the rest of the budget is split.  Join and TotalBitRate keep the budget at least 1 kbps per member.
+		double budget = totalBitRate - count;
+		double guaranteed = minimumShare * budget / count;
+		double shared = budget - guaranteed * count;
+		for each (MultiplexMember^ member in members)
+		{
+			double demand = member->hasDemand ? member->demand : assumed;
+			double share = totalDemand > 0 ? demand / totalDemand : 1.0 / count;
+			// Rounding down keeps the sum within the budget.
+			member->allocation = 1 + (int)(guaranteed + shared * share);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+#include "X264Options.h"
+
+using namespace System;
+using namespace System::Collections::Generic;
+
+namespace x264net {
+
+	ref class X264Net;
+	ref class BitrateMultiplexer;
+
+	/// <summary>
+	/// <para>One encoder's share of a BitrateMultiplexer's budget.</para>
+	/// </summary>
+	ref class MultiplexMember
+	{
+	public:
+		BitrateMultiplexer^ multiplexer;
+		X264Net^ encoder;
+		/// <summary>The rate factor the encoder aims for, or 0 if it is not in CRF mode.</summary>
+		double referenceQuality;
+		double frameRate;
+		/// <summary>The number of frames the demand estimate is averaged over.</summary>
+		double windowFrames;
+		/// <summary>Kilobits per second the encoder would need for its reference quality, averaged over recent frames.</summary>
+		double demand;
+		bool hasDemand;
+		/// <summary>Kilobits per second assigned by the multiplexer.</summary>
+		int allocation;
+		/// <summary>Kilobits per second the encoder's VBV is currently configured for.  Only touched by the encoding thread.</summary>
+		int applied;
+		MultiplexMember(BitrateMultiplexer^ multiplexer, X264Net^ encoder);
+		int Report(int frameSize, double rateFactor);
+	};
+
+	/// <summary>
+	/// <para>Shares one total bit rate among several encoders (e.g. every stream on an uplink), giving more to streams with busy content and less to static ones, instead of capping each at a fixed MaxBitRate.</para>
+	/// <para>After each frame an encoder outputs, its recent frame sizes and effective rate factor give an estimate of the bit rate it needs for its configured Quality.  The budget is split in proportion to those estimates, after each member is guaranteed MinimumShare of an equal split, and each encoder applies its new allocation to x264's VBV (maximum rate and buffer size; the average rate too with ConstantBitRate) through x264_encoder_reconfig before its next frame.  The allocations always add up to no more than TotalBitRate.</para>
+	/// <para>Members must be created with MaxBitRate set, since x264 can only retune a VBV that was enabled when it opened, and without multi-pass encoding.  Encoders may run on different threads.</para>
+	/// </summary>
+	public ref class BitrateMultiplexer
+	{
+	private:
+		List<MultiplexMember^>^ members;
+		int totalBitRate;
+		double minimumShare;
+		void Rebalance();
+	internal:
+		int Report(MultiplexMember^ member, int frameSize, double rateFactor);
+	public:
+		/// <summary>
+		/// <para>Create a multiplexer with a total budget in kilobits per second.</para>
+		/// </summary>
+		BitrateMultiplexer(int totalBitRate);
+		/// <summary>
+		/// <para>The total budget in kilobits per second.  Changes take effect on each member's next frame.  It cannot be set below MemberCount, since every member gets at least 1 kbps.</para>
+		/// </summary>
+		property int TotalBitRate { int get(); void set(int value); }
+		/// <summary>
+		/// <para>The fraction (0 to 1) of an equal split that every member gets regardless of its content, so a stream that turns busy after a static period does not start from nothing.  Default 0.25.</para>
+		/// </summary>
+		property double MinimumShare { double get(); void set(double value); }
+		/// <summary>
+		/// <para>The number of encoders sharing the budget.</para>
+		/// </summary>
+		property int MemberCount { int get(); }
+		/// <summary>
+		/// <para>Adds an encoder to the multiplexer.  Its VBV is retuned from its next frame on.  An encoder can belong to one multiplexer at a time.  Throws if the multiplexer already has TotalBitRate members, since every member gets at least 1 kbps.</para>
+		/// </summary>
+		void Join(X264Net^ encoder);
+		/// <summary>
+		/// <para>Removes an encoder, which keeps its last allocation.  Disposing an encoder removes it automatically.</para>
+		/// </summary>
+		void Leave(X264Net^ encoder);
+		/// <summary>
+		/// <para>The bit rate in kilobits per second currently assigned to an encoder, or 0 if it is not a member.</para>
+		/// </summary>
+		int GetAllocatedBitRate(X264Net^ encoder);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "BroadcastRing.h"
+
+#pragma managed( push, off )
+namespace x264net
+{
+	BroadcastRing::BroadcastRing(int capacity, EncodedBufferPool* pool) : capacity(capacity < 2 ? 2 : capacity), head(0), lastKeyframe(-1), refs(1), pool(pool)
+	{
+		slots = new std::atomic<EncodedBuffer*>[this->capacity];
+		for (int i = 0; i < this->capacity; i++)
+			slots[i].store(NULL, std::memory_order_relaxed);
+		if (pool)
+			pool->AddRef();
+	}
+	BroadcastRing::~BroadcastRing()
+	{
+		for (int i = 0; i < capacity; i++)
+		{
+			EncodedBuffer* buffer = slots[i].load(std::memory_order_relaxed);
+			if (buffer)
+				buffer->Release();
+		}
+		delete[] slots;
+		if (pool)
+			pool->Release();
+	}
+	void BroadcastRing::AddRef()
+	{
+		refs.fetch_add(1, std::memory_order_relaxed);
+	}
+	void BroadcastRing::Release()
+	{
+		if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			delete this;
+	}
+	void BroadcastRing::Publish(EncodedBuffer* buffer)
+	{
+		int64_t sequence = head.load(std::memory_order_relaxed);
+		buffer->AddRef();
+		buffer->sequence.store(sequence, std::memory_order_release);
+		EncodedBuffer* old = slots[sequence % capacity].exchange(buffer, std::memory_order_acq_rel);
+		if (buffer->keyframe)
+			lastKeyframe.store(sequence, std::memory_order_release);
+		head.store(sequence + 1, std::memory_order_release);
+		if (old)
+			old->Release();
+	}
+	BroadcastRing::ReadStatus BroadcastRing::TryRead(int64_t sequence, EncodedBuffer** buffer)
+	{
+		int64_t currentHead = head.load(std::memory_order_acquire);
+		if (sequence >= currentHead)
+			return ReadEmpty;
+		if (currentHead - sequence > capacity)
+			return ReadOverrun;
+		EncodedBuffer* candidate = slots[sequence % capacity].load(std::memory_order_acquire);
+		// The writer may overwrite the slot (and the buffer may be recycled) at any moment, so take a
+		// reference only if the buffer is still alive, then confirm it is still the one we asked for.
+		if (!candidate || !candidate->TryAddRef())
+			return ReadOverrun;
+		if (candidate->sequence.load(std::memory_order_acquire) != sequence)
+		{
+			candidate->Release();
+			return ReadOverrun;
+		}
+		*buffer = candidate;
+		return ReadOk;
+	}
+}
+#pragma managed( pop )
@@ -0,0 +1,71 @@
+#pragma once
+#include "EncodedBuffer.h"
+#pragma managed( push, off )
+#include <atomic>
+#pragma managed( pop )
+
+#pragma managed( push, off )
+namespace x264net
+{
+	/// <summary>
+	/// <para>A single-writer, many-reader ring of published access units.  Each published buffer is assigned the next sequence number and stays readable until it is overwritten capacity publishes later.</para>
+	/// <para>Readers never take a lock and never block the writer.  A reader that falls too far behind simply finds its frames gone (ReadOverrun) and must skip ahead.</para>
+	/// <para>The ring is reference counted so that subscribers can outlive the broadcaster that created it.</para>
+	/// </summary>
+	class BroadcastRing
+	{
+	public:
+		enum ReadStatus
+		{
+			/// <summary>The requested frame was returned.</summary>
+			ReadOk,
+			/// <summary>The requested frame has not been published yet.</summary>
+			ReadEmpty,
+			/// <summary>The requested frame has already been overwritten.</summary>
+			ReadOverrun
+		};
+		/// <summary>
+		/// <para>Creates a ring with a reference count of 1.  The ring keeps a reference to pool (which may be NULL), because readers may touch recycled buffers from it.</para>
+		/// </summary>
+		BroadcastRing(int capacity, EncodedBufferPool* pool);
+		void AddRef();
+		void Release();
+		/// <summary>
+		/// <para>Publishes a buffer, which must have come from this ring's pool.  The ring takes its own reference.  Must only be called by one thread at a time.</para>
+		/// </summary>
+		void Publish(EncodedBuffer* buffer);
+		/// <summary>
+		/// <para>Gets the sequence number the next published buffer will receive.</para>
+		/// </summary>
+		int64_t Head() const
+		{
+			return head.load(std::memory_order_acquire);
+		}
+		/// <summary>
+		/// <para>Gets the sequence number of the most recently published keyframe, or -1 if none has been published.</para>
+		/// </summary>
+		int64_t LastKeyframe() const
+		{
+			return lastKeyframe.load(std::memory_order_acquire);
+		}
+		int Capacity() const
+		{
+			return capacity;
+		}
+		/// <summary>
+		/// <para>Attempts to read the buffer with the given sequence number.  On ReadOk, *buffer holds a new reference which the caller must Release().</para>
+		/// </summary>
+		ReadStatus TryRead(int64_t sequence, EncodedBuffer** buffer);
+	private:
+		~BroadcastRing();
+		std::atomic<EncodedBuffer*>* slots;
+		int capacity;
+		std::atomic<int64_t> head;
+		std::atomic<int64_t> lastKeyframe;
+		std::atomic<long> refs;
+		EncodedBufferPool* pool;
+		BroadcastRing(const BroadcastRing&);
+		BroadcastRing& operator=(const BroadcastRing&);
+	};
+}
+#pragma managed( pop )
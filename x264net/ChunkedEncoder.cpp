@@ -0,0 +1,171 @@
+#include "ChunkedEncoder.h"
+#include "x264net.h"
+namespace x264net
+{
+	/// <summary>
+	/// <para>The state of one call to ChunkedEncoder.Encode, shared by its worker threads.</para>
+	/// </summary>
+	ref class ChunkJob
+	{
+	public:
+		X264Options^ chunkOptions;
+		Func<int, array<Byte>^>^ getFrame;
+		System::IO::Stream^ output;
+		int frameCount;
+		int chunkLength;
+		int chunkCount;
+		int nextChunkToEncode;
+		int nextChunkToWrite;
+		/// <summary>How far past nextChunkToWrite a worker may start a chunk, which bounds the finished chunks held in memory.</summary>
+		int maxChunksAhead;
+		Dictionary<int, array<Byte>^>^ finishedChunks;
+		volatile bool failed;
+
+		void Worker(int workerIndex)
+		{
+			try
+			{
+				while (!failed)
+				{
+					int chunk = System::Threading::Interlocked::Increment(nextChunkToEncode) - 1;
+					if (chunk >= chunkCount)
+						return;
+					if (!WaitForTurn(chunk))
+						return;
+					WriteInOrder(chunk, EncodeChunk(chunk));
+				}
+			}
+			catch (Exception^)
+			{
+				failed = true;
+				System::Threading::Monitor::Enter(finishedChunks);
+				System::Threading::Monitor::PulseAll(finishedChunks);
+				System::Threading::Monitor::Exit(finishedChunks);
+				throw;
+			}
+		}
+		/// <summary>
+		/// <para>Blocks while the chunk is too far ahead of the next one to be written, so one slow chunk cannot leave most of the file buffered.  The chunk at nextChunkToWrite has always been taken by a worker that is not waiting, so this cannot deadlock.  Returns false if another worker failed.</para>
+		/// </summary>
+		bool WaitForTurn(int chunk)
+		{
+			System::Threading::Monitor::Enter(finishedChunks);
+			try
+			{
+				while (!failed && chunk - nextChunkToWrite >= maxChunksAhead)
+					System::Threading::Monitor::Wait(finishedChunks);
+				return !failed;
+			}
+			finally
+			{
+				System::Threading::Monitor::Exit(finishedChunks);
+			}
+		}
+		array<Byte>^ EncodeChunk(int chunk)
+		{
+			int firstFrame = chunk * chunkLength;
+			int lastFrame = Math::Min(firstFrame + chunkLength, frameCount);
+			System::IO::MemoryStream^ encoded = gcnew System::IO::MemoryStream();
+			X264Net^ encoder = gcnew X264Net(chunkOptions, true, firstFrame);
+			try
+			{
+				for (int i = firstFrame; i < lastFrame && !failed; i++)
+				{
+					array<Byte>^ data = encoder->EncodeFrameAsWholeArray(getFrame(i));
+					encoded->Write(data, 0, data->Length);
+				}
+				array<Byte>^ data = encoder->Flush();
+				encoded->Write(data, 0, data->Length);
+			}
+			finally
+			{
+				delete encoder;
+			}
+			return encoded->ToArray();
+		}
+		void WriteInOrder(int chunk, array<Byte>^ data)
+		{
+			// Chunks finish out of order; write every chunk that is next in line.
+			System::Threading::Monitor::Enter(finishedChunks);
+			try
+			{
+				finishedChunks[chunk] = data;
+				array<Byte>^ ready;
+				while (!failed && finishedChunks->TryGetValue(nextChunkToWrite, ready))
+				{
+					finishedChunks->Remove(nextChunkToWrite);
+					output->Write(ready, 0, ready->Length);
+					nextChunkToWrite++;
+					System::Threading::Monitor::PulseAll(finishedChunks);
+				}
+			}
+			finally
+			{
+				System::Threading::Monitor::Exit(finishedChunks);
+			}
+		}
+	};
+
+	/// <summary>
+	/// <para>Adapts an in-memory list of frames to the getFrame callback.</para>
+	/// </summary>
+	ref class ListFrameSource
+	{
+	private:
+		IList<array<Byte>^>^ frames;
+	public:
+		ListFrameSource(IList<array<Byte>^>^ frames) : frames(frames)
+		{
+		}
+		array<Byte>^ Get(int index)
+		{
+			return frames[index];
+		}
+	};
+
+	ChunkedEncoder::ChunkedEncoder(X264Options^ options, int chunkLength) : Options(options), ChunkLength(chunkLength)
+	{
+		MaxParallelChunks = System::Environment::ProcessorCount;
+		ThreadsPerChunk = 1;
+	}
+	void ChunkedEncoder::Encode(Func<int, array<Byte>^>^ getFrame, int frameCount, System::IO::Stream^ output)
+	{
+		if (ChunkLength < 1)
+			throw gcnew Exception("ChunkLength must be at least 1. Provided value: " + ChunkLength);
+		// Every chunk encoder would open the same StatsFile at once.
+		if (Options->Pass > 0)
+			throw gcnew InvalidOperationException("Chunked encoding is not supported with multi-pass encoding");
+		if (frameCount < 1)
+			return;
+
+		ChunkJob^ job = gcnew ChunkJob();
+		job->chunkOptions = Options->Clone();
+		job->chunkOptions->Threads = ThreadsPerChunk;
+		job->getFrame = getFrame;
+		job->output = output;
+		job->frameCount = frameCount;
+		job->chunkLength = ChunkLength;
+		job->chunkCount = (int)((frameCount + (int64_t)ChunkLength - 1) / ChunkLength);
+		job->nextChunkToEncode = 0;
+		job->nextChunkToWrite = 0;
+		job->finishedChunks = gcnew Dictionary<int, array<Byte>^>();
+		job->failed = false;
+
+		int workers = Math::Max(1, Math::Min(MaxParallelChunks, job->chunkCount));
+		job->maxChunksAhead = workers * 2;
+		try
+		{
+			System::Threading::Tasks::Parallel::For(0, workers, gcnew Action<int>(job, &ChunkJob::Worker));
+		}
+		catch (AggregateException^ ex)
+		{
+			throw gcnew Exception("Chunked encoding failed: " + ex->InnerException->Message, ex->InnerException);
+		}
+	}
+	array<Byte>^ ChunkedEncoder::Encode(IList<array<Byte>^>^ frames)
+	{
+		System::IO::MemoryStream^ output = gcnew System::IO::MemoryStream();
+		Encode(gcnew Func<int, array<Byte>^>(gcnew ListFrameSource(frames), &ListFrameSource::Get), frames->Count, output);
+		return output->ToArray();
+	}
+}
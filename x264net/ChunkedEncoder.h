@@ -0,0 +1,51 @@
+#pragma once
+#include "X264Options.h"
+
+using namespace System;
+using namespace System::Collections::Generic;
+
+namespace x264net {
+
+	/// <summary>
+	/// <para>Encodes a whole recording offline by splitting it into fixed-length chunks of closed GOPs and encoding the chunks in parallel, each on its own single-threaded encoder.  Throughput scales with the number of cores rather than with x264's frame threading.</para>
+	/// <para>Every chunk starts with an IDR frame, and all chunk encoders share the same options with content-independent ("stitchable") SPS/PPS, so the Annex-B outputs are simply concatenated in order.</para>
+	/// <para>Not suitable for live streams: output is only available once a chunk is complete.</para>
+	/// </summary>
+	public ref class ChunkedEncoder
+	{
+	public:
+		/// <summary>
+		/// <para>The options each chunk encoder is created with.  Threads is ignored; see ThreadsPerChunk.  Pass must be 0.</para>
+		/// </summary>
+		X264Options^ Options;
+		/// <summary>
+		/// <para>The number of frames in each chunk (the last chunk may be shorter).  Longer chunks compress slightly better; shorter chunks parallelize better.</para>
+		/// </summary>
+		int ChunkLength;
+		/// <summary>
+		/// <para>The maximum number of chunks to encode at once.  Default: the number of logical processors.</para>
+		/// </summary>
+		int MaxParallelChunks;
+		/// <summary>
+		/// <para>The number of x264 threads each chunk encoder uses.  Default: 1</para>
+		/// </summary>
+		int ThreadsPerChunk;
+
+		/// <summary>
+		/// <para>Create a ChunkedEncoder.</para>
+		/// </summary>
+		/// <param name="options">The encoding options to use for every chunk.</param>
+		/// <param name="chunkLength">The number of frames in each chunk.</param>
+		ChunkedEncoder(X264Options^ options, int chunkLength);
+
+		/// <summary>
+		/// <para>Encodes frameCount frames, writing the H.264 Annex-B stream to output in order.</para>
+		/// <para>getFrame is called with a frame index and must return that frame's image data in Options.InputFormat, laid out as for X264Net.EncodeFrameAsWholeArray (Height rows of InputStride bytes, or tightly packed).  It is called concurrently from several threads, with indices from different chunks.</para>
+		/// </summary>
+		void Encode(Func<int, array<Byte>^>^ getFrame, int frameCount, System::IO::Stream^ output);
+		/// <summary>
+		/// <para>Encodes a list of frames, each laid out as for X264Net.EncodeFrameAsWholeArray, returning the whole H.264 Annex-B stream.</para>
+		/// </summary>
+		array<Byte>^ Encode(IList<array<Byte>^>^ frames);
+	};
+}
@@ -0,0 +1,258 @@
+#pragma once
+#include "stdint.h"
+#include "lib/x264/include/x264.h"
+#include "SpinLock.h"
+#pragma managed( push, off )
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#pragma managed( pop )
+
+#pragma managed( push, off )
+namespace x264net
+{
+	class EncodedBufferPool;
+
+	/// <summary>
+	/// <para>An immutable, reference-counted copy of one encoded access unit (all NAL units produced by one call to x264_encoder_encode).</para>
+	/// <para>The header and payload live in a single allocation.  Whoever holds a reference must call Release() exactly once when finished.</para>
+	/// </summary>
+	struct EncodedBuffer
+	{
+		std::atomic<long> refs;
+		/// <summary>Position of this buffer in a broadcast stream, or -1 if it has not been published.  Readers use this to detect a buffer that was recycled while they were looking at it.</summary>
+		std::atomic<int64_t> sequence;
+		/// <summary>Number of bytes in data.</summary>
+		int size;
+		/// <summary>Number of bytes data can hold.</summary>
+		int capacity;
+		/// <summary>Presentation timestamp reported by x264 in pic_out.</summary>
+		int64_t pts;
+		/// <summary>Decode timestamp reported by x264 in pic_out.</summary>
+		int64_t dts;
+		/// <summary>True if x264 flagged this access unit as a keyframe (an IDR frame, or the recovery point of an intra refresh).</summary>
+		bool keyframe;
+		/// <summary>True if this access unit carries its own SPS and PPS.</summary>
+		bool hasParameterSets;
+		/// <summary>Annex-B payload of all NAL units, back to back.</summary>
+		uint8_t* data;
+		/// <summary>The pool this buffer returns to when released, or NULL if it was allocated on its own.</summary>
+		EncodedBufferPool* pool;
+
+		/// <summary>
+		/// <para>Copies raw bytes into a new buffer with a reference count of 1.  If pool is not NULL, the buffer is taken from it.  Returns NULL if memory could not be allocated.</para>
+		/// </summary>
+		static EncodedBuffer* Create(const uint8_t* payload, int payloadSize, EncodedBufferPool* pool = NULL);
+		/// <summary>
+		/// <para>Copies the output of x264_encoder_encode into a new buffer with a reference count of 1.  If pool is not NULL, the buffer is taken from it.  Returns NULL if memory could not be allocated.</para>
+		/// <para>x264 guarantees that the payloads of all output NALs are sequential in memory, so this is a single copy.</para>
+		/// </summary>
+		static EncodedBuffer* Create(x264_nal_t* nals, int i_nals, int frame_size, x264_picture_t* pic_out, EncodedBufferPool* pool = NULL)
+		{
+			EncodedBuffer* buffer = Create(i_nals > 0 ? nals[0].p_payload : NULL, frame_size, pool);
+			if (!buffer)
+				return NULL;
+			buffer->pts = pic_out->i_pts;
+			buffer->dts = pic_out->i_dts;
+			buffer->keyframe = pic_out->b_keyframe != 0;
+			for (int i = 0; i < i_nals; i++)
+			{
+				if (nals[i].i_type == NAL_SPS)
+				{
+					buffer->hasParameterSets = true;
+					break;
+				}
+			}
+			return buffer;
+		}
+		void AddRef()
+		{
+			refs.fetch_add(1, std::memory_order_relaxed);
+		}
+		/// <summary>
+		/// <para>Adds a reference only if the buffer is still alive (its count is not zero).  Only safe on pooled buffers, whose memory is never freed while the pool is alive.</para>
+		/// </summary>
+		bool TryAddRef()
+		{
+			long current = refs.load(std::memory_order_relaxed);
+			while (current != 0)
+			{
+				if (refs.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed))
+					return true;
+			}
+			return false;
+		}
+		void Release();
+		/// <summary>
+		/// <para>Returns the buffer whose data pointer this is.</para>
+		/// </summary>
+		static EncodedBuffer* FromData(void* data)
+		{
+			return (EncodedBuffer*)data - 1;
+		}
+		/// <summary>
+		/// <para>Releases the buffer whose data pointer this is.  Matches the signature of x264's free callbacks (e.g. x264_sei_t.sei_free), so pooled buffers can be handed to x264 and returned to the pool when it is done with them.</para>
+		/// </summary>
+		static void ReleaseData(void* data)
+		{
+			if (data)
+				FromData(data)->Release();
+		}
+	private:
+		friend class EncodedBufferPool;
+		EncodedBuffer* nextFree;
+		static EncodedBuffer* Allocate(int capacity)
+		{
+			void* memory = malloc(sizeof(EncodedBuffer) + capacity);
+			if (!memory)
+				return NULL;
+			EncodedBuffer* buffer = new (memory) EncodedBuffer();
+			buffer->refs.store(0, std::memory_order_relaxed);
+			buffer->sequence.store(-1, std::memory_order_relaxed);
+			buffer->capacity = capacity;
+			buffer->data = (uint8_t*)(buffer + 1);
+			buffer->pool = NULL;
+			buffer->nextFree = NULL;
+			return buffer;
+		}
+		static void Free(EncodedBuffer* buffer)
+		{
+			buffer->~EncodedBuffer();
+			free(buffer);
+		}
+		EncodedBuffer()
+		{
+		}
+		~EncodedBuffer()
+		{
+		}
+		EncodedBuffer(const EncodedBuffer&);
+		EncodedBuffer& operator=(const EncodedBuffer&);
+	};
+
+	/// <summary>
+	/// <para>Recycles EncodedBuffers in power-of-two size classes so that steady-state encoding does not touch the heap.</para>
+	/// <para>Buffer memory is never freed while the pool is alive, which is what allows lock-free readers to safely call TryAddRef() on a buffer pointer that may have been recycled underneath them.  The pool is itself reference counted: each outstanding buffer holds a reference, so the pool is destroyed only after its owner and every buffer have released it.</para>
+	/// </summary>
+	class EncodedBufferPool
+	{
+	public:
+		EncodedBufferPool() : refs(1)
+		{
+			for (int i = 0; i < ClassCount; i++)
+				freeLists[i] = NULL;
+		}
+		void AddRef()
+		{
+			refs.fetch_add(1, std::memory_order_relaxed);
+		}
+		void Release()
+		{
+			if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				delete this;
+		}
+		/// <summary>
+		/// <para>Returns a buffer that can hold at least size bytes, with a reference count of 1 and a sequence of -1.  Returns NULL if memory could not be allocated.</para>
+		/// </summary>
+		EncodedBuffer* Acquire(int size)
+		{
+			if (size > (MinimumCapacity << (ClassCount - 1)))
+				return NULL;
+			int sizeClass = SizeClass(size);
+			EncodedBuffer* buffer = NULL;
+			{
+				SpinLockGuard guard(lock);
+				buffer = freeLists[sizeClass];
+				if (buffer)
+					freeLists[sizeClass] = buffer->nextFree;
+			}
+			if (!buffer)
+			{
+				buffer = EncodedBuffer::Allocate(MinimumCapacity << sizeClass);
+				if (!buffer)
+					return NULL;
+				buffer->pool = this;
+			}
+			AddRef();
+			// The sequence must read -1 before the buffer can be seen as alive by a reader holding a stale pointer.
+			buffer->sequence.store(-1, std::memory_order_relaxed);
+			buffer->refs.store(1, std::memory_order_release);
+			return buffer;
+		}
+		/// <summary>
+		/// <para>Called by EncodedBuffer::Release() when a pooled buffer's reference count reaches zero.</para>
+		/// </summary>
+		void Return(EncodedBuffer* buffer)
+		{
+			int sizeClass = SizeClass(buffer->capacity);
+			{
+				SpinLockGuard guard(lock);
+				buffer->nextFree = freeLists[sizeClass];
+				freeLists[sizeClass] = buffer;
+			}
+			Release();
+		}
+	private:
+		static const int MinimumCapacity = 1024;
+		static const int ClassCount = 21;
+		static int SizeClass(int size)
+		{
+			int sizeClass = 0;
+			while (sizeClass < ClassCount - 1 && (MinimumCapacity << sizeClass) < size)
+				sizeClass++;
+			return sizeClass;
+		}
+		~EncodedBufferPool()
+		{
+			for (int i = 0; i < ClassCount; i++)
+			{
+				while (freeLists[i])
+				{
+					EncodedBuffer* next = freeLists[i]->nextFree;
+					EncodedBuffer::Free(freeLists[i]);
+					freeLists[i] = next;
+				}
+			}
+		}
+		std::atomic<long> refs;
+		SpinLock lock;
+		EncodedBuffer* freeLists[ClassCount];
+		EncodedBufferPool(const EncodedBufferPool&);
+		EncodedBufferPool& operator=(const EncodedBufferPool&);
+	};
+
+	inline EncodedBuffer* EncodedBuffer::Create(const uint8_t* payload, int payloadSize, EncodedBufferPool* pool)
+	{
+		EncodedBuffer* buffer;
+		if (pool)
+			buffer = pool->Acquire(payloadSize);
+		else
+		{
+			buffer = Allocate(payloadSize);
+			if (buffer)
+				buffer->refs.store(1, std::memory_order_relaxed);
+		}
+		if (!buffer)
+			return NULL;
+		buffer->size = payloadSize;
+		buffer->pts = 0;
+		buffer->dts = 0;
+		buffer->keyframe = false;
+		buffer->hasParameterSets = false;
+		if (payloadSize > 0)
+			memcpy(buffer->data, payload, payloadSize);
+		return buffer;
+	}
+	inline void EncodedBuffer::Release()
+	{
+		if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			if (pool)
+				pool->Return(this);
+			else
+				Free(this);
+		}
+	}
+}
+#pragma managed( pop )
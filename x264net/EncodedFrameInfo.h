@@ -0,0 +1,74 @@
+#pragma once
+#include "stdint.h"
+#include "FrameRecord.h"
+
+using namespace System;
+
+namespace x264net {
+
+	/// <summary>
+	/// <para>One encoded frame together with the token its input was submitted with, its timestamps, and where the time between submission and output was spent.</para>
+	/// <para>Because x264 may hold frames back (B-frames, lookahead, frame threads), the frame returned by a call is not necessarily the frame submitted by that call; use Token to match them.</para>
+	/// </summary>
+	public ref class EncodedFrameInfo
+	{
+	private:
+		array<Byte>^ data;
+		Int64 token;
+		Int64 pts;
+		Int64 dts;
+		bool keyframe;
+		TimeSpan conversionTime;
+		TimeSpan queueTime;
+		TimeSpan encodeTime;
+		static TimeSpan Elapsed(int64_t from, int64_t to)
+		{
+			return TimeSpan::FromTicks((Int64)((to - from) * ((double)TimeSpan::TicksPerSecond / System::Diagnostics::Stopwatch::Frequency)));
+		}
+	internal:
+		EncodedFrameInfo(array<Byte>^ data, const FrameRecord* record, int64_t pts, int64_t dts, bool keyframe)
+			: data(data), token(record->token), pts(pts), dts(dts), keyframe(keyframe)
+		{
+			conversionTime = Elapsed(record->submitted, record->queued);
+			queueTime = Elapsed(record->queued, record->encodeStarted);
+			encodeTime = Elapsed(record->encodeStarted, record->encodeFinished);
+		}
+	public:
+		/// <summary>
+		/// <para>One or more H.264 NAL units which are the encoded form of the frame.</para>
+		/// </summary>
+		property array<Byte>^ Data { array<Byte>^ get() { return data; } }
+		/// <summary>
+		/// <para>The token the frame was submitted with.</para>
+		/// </summary>
+		property Int64 Token { Int64 get() { return token; } }
+		/// <summary>
+		/// <para>The presentation timestamp x264 reported for this frame.</para>
+		/// </summary>
+		property Int64 Pts { Int64 get() { return pts; } }
+		/// <summary>
+		/// <para>The decode timestamp x264 reported for this frame.</para>
+		/// </summary>
+		property Int64 Dts { Int64 get() { return dts; } }
+		/// <summary>
+		/// <para>True if this frame is a keyframe (an IDR frame, or the start of an intra refresh).</para>
+		/// </summary>
+		property bool IsKeyframe { bool get() { return keyframe; } }
+		/// <summary>
+		/// <para>Time from submission until the frame was converted and handed to x264.</para>
+		/// </summary>
+		property TimeSpan ConversionTime { TimeSpan get() { return conversionTime; } }
+		/// <summary>
+		/// <para>Time the frame spent waiting inside x264 before the call that produced its output began.  Zero unless x264 delays frames.</para>
+		/// </summary>
+		property TimeSpan QueueTime { TimeSpan get() { return queueTime; } }
+		/// <summary>
+		/// <para>Duration of the x264_encoder_encode call that produced the frame's output.</para>
+		/// </summary>
+		property TimeSpan EncodeTime { TimeSpan get() { return encodeTime; } }
+		/// <summary>
+		/// <para>Total time from submission to output: ConversionTime + QueueTime + EncodeTime.</para>
+		/// </summary>
+		property TimeSpan Latency { TimeSpan get() { return conversionTime + queueTime + encodeTime; } }
+	};
+}
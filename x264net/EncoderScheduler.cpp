@@ -0,0 +1,346 @@
+#include "EncoderScheduler.h"
+#include "x264net.h"
+namespace x264net
+{
+	/// <summary>
+	/// <para>One frame waiting in a ScheduledEncoder's queue.</para>
+	/// </summary>
+	ref class ScheduledFrame
+	{
+	public:
+		array<Byte>^ data;
+		Int64 timestamp;
+		bool hasTimestamp;
+		ScheduledFrame(array<Byte>^ data, Int64 timestamp, bool hasTimestamp) : data(data), timestamp(timestamp), hasTimestamp(hasTimestamp)
+		{
+		}
+	};
+
+	/// <summary>
+	/// <para>The most frames one encoder may encode before yielding its worker to the next encoder in line.</para>
+	/// </summary>
+	static const int FramesPerTurn = 4;
+
+	ScheduledEncoder::ScheduledEncoder(EncoderScheduler^ scheduler, X264Net^ encoder, Action<array<Byte>^>^ onEncoded, int worker)
+		: scheduler(scheduler), encoder(encoder), onEncoded(onEncoded), lastWorker(worker)
+	{
+		frames = gcnew Queue<ScheduledFrame^>();
+		scheduled = false;
+		unregistered = false;
+	}
+	int ScheduledEncoder::PendingFrames::get()
+	{
+		System::Threading::Monitor::Enter(frames);
+		try
+		{
+			return frames->Count;
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(frames);
+		}
+	}
+	void ScheduledEncoder::Submit(array<Byte>^ frame)
+	{
+		Submit(gcnew ScheduledFrame(frame, 0, false));
+	}
+	void ScheduledEncoder::Submit(array<Byte>^ frame, Int64 timestamp)
+	{
+		Submit(gcnew ScheduledFrame(frame, timestamp, true));
+	}
+	void ScheduledEncoder::Submit(ScheduledFrame^ frame)
+	{
+		if (frame->data == nullptr)
+			throw gcnew ArgumentNullException("frame");
+		scheduler->Submit(this, frame);
+	}
+	/// <summary>
+	/// <para>Adds a frame to the queue, and returns true if the encoder was idle and must now be queued on a worker.</para>
+	/// </summary>
+	bool ScheduledEncoder::Queue(ScheduledFrame^ frame)
+	{
+		bool schedule = false;
+		System::Threading::Monitor::Enter(frames);
+		try
+		{
+			if (unregistered)
+				throw gcnew InvalidOperationException("The encoder has been unregistered from its scheduler");
+			if (fault != nullptr)
+				throw gcnew Exception("A previous frame failed to encode: " + fault->Message, fault);
+			frames->Enqueue(frame);
+			if (!scheduled)
+			{
+				scheduled = true;
+				schedule = true;
+			}
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(frames);
+		}
+		return schedule;
+	}
+	/// <summary>
+	/// <para>Marks the encoder as no longer running or queued, and wakes Drain.  Must be called with the frames lock held.</para>
+	/// </summary>
+	void ScheduledEncoder::Idle()
+	{
+		scheduled = false;
+		System::Threading::Monitor::PulseAll(frames);
+	}
+	/// <summary>
+	/// <para>Refuses further frames and waits until the ones already submitted have been encoded.  Returns false if the encoder had already been unregistered.</para>
+	/// </summary>
+	bool ScheduledEncoder::Drain()
+	{
+		System::Threading::Monitor::Enter(frames);
+		try
+		{
+			bool wasRegistered = !unregistered;
+			unregistered = true;
+			while (scheduled)
+				System::Threading::Monitor::Wait(frames);
+			return wasRegistered;
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(frames);
+		}
+	}
+	bool ScheduledEncoder::RunTurn(int worker)
+	{
+		lastWorker = worker;
+		for (int i = 0; i < FramesPerTurn; i++)
+		{
+			ScheduledFrame^ frame;
+			System::Threading::Monitor::Enter(frames);
+			try
+			{
+				if (frames->Count == 0)
+				{
+					Idle();
+					return false;
+				}
+				frame = frames->Dequeue();
+			}
+			finally
+			{
+				System::Threading::Monitor::Exit(frames);
+			}
+			try
+			{
+				array<Byte>^ data = frame->hasTimestamp ? encoder->EncodeFrameAsWholeArray(frame->data, frame->timestamp) : encoder->EncodeFrameAsWholeArray(frame->data);
+				if (onEncoded != nullptr)
+					onEncoded(data);
+			}
+			catch (Exception^ ex)
+			{
+				System::Threading::Monitor::Enter(frames);
+				try
+				{
+					fault = ex;
+					frames->Clear();
+					Idle();
+				}
+				finally
+				{
+					System::Threading::Monitor::Exit(frames);
+				}
+				return false;
+			}
+		}
+		System::Threading::Monitor::Enter(frames);
+		try
+		{
+			if (frames->Count == 0)
+			{
+				Idle();
+				return false;
+			}
+			return true;
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(frames);
+		}
+	}
+
+	EncoderScheduler::EncoderScheduler()
+	{
+		Start(System::Environment::ProcessorCount);
+	}
+	EncoderScheduler::EncoderScheduler(int workerCount)
+	{
+		Start(workerCount);
+	}
+	void EncoderScheduler::Start(int workerCount)
+	{
+		if (workerCount < 1)
+			throw gcnew Exception("workerCount must be at least 1. Provided value: " + workerCount);
+		isDisposed = false;
+		submitting = 0;
+		nextWorker = 0;
+		registered = gcnew HashSet<X264Net^>();
+		available = gcnew System::Threading::SemaphoreSlim(0);
+		queues = gcnew array<LinkedList<ScheduledEncoder^>^>(workerCount);
+		workers = gcnew array<System::Threading::Thread^>(workerCount);
+		for (int i = 0; i < workerCount; i++)
+			queues[i] = gcnew LinkedList<ScheduledEncoder^>();
+		for (int i = 0; i < workerCount; i++)
+		{
+			workers[i] = gcnew System::Threading::Thread(gcnew System::Threading::ParameterizedThreadStart(this, &EncoderScheduler::Worker));
+			workers[i]->IsBackground = true;
+			workers[i]->Name = "EncoderScheduler worker " + i;
+			workers[i]->Start(i);
+		}
+	}
+	EncoderScheduler::~EncoderScheduler()
+	{
+		System::Threading::Monitor::Enter(registered);
+		try
+		{
+			if (isDisposed)
+				return;
+			isDisposed = true;
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(registered);
+		}
+		// A Submit counts itself in before it checks isDisposed, so once the count drops to zero no frame can be queued after the workers are told to finish.
+		System::Threading::Thread::MemoryBarrier();
+		System::Threading::SpinWait spin;
+		while (System::Threading::Volatile::Read(submitting) != 0)
+			spin.SpinOnce();
+		// One extra wake per worker.  A worker that wakes and finds every queue empty exits, so the queued frames are encoded first.
+		available->Release(workers->Length);
+		for (int i = 0; i < workers->Length; i++)
+			workers[i]->Join();
+		delete available;
+	}
+	ScheduledEncoder^ EncoderScheduler::Register(X264Net^ encoder, Action<array<Byte>^>^ onEncoded)
+	{
+		if (encoder == nullptr)
+			throw gcnew ArgumentNullException("encoder");
+		System::Threading::Monitor::Enter(registered);
+		try
+		{
+			if (isDisposed)
+				throw gcnew ObjectDisposedException("EncoderScheduler");
+			// Two ScheduledEncoders for one encoder could run it on two workers at once.
+			if (!registered->Add(encoder))
+				throw gcnew InvalidOperationException("The encoder is already registered with this scheduler");
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(registered);
+		}
+		int worker = (int)((unsigned int)System::Threading::Interlocked::Increment(nextWorker) % (unsigned int)workers->Length);
+		return gcnew ScheduledEncoder(this, encoder, onEncoded, worker);
+	}
+	void EncoderScheduler::Unregister(ScheduledEncoder^ encoder)
+	{
+		if (encoder == nullptr)
+			throw gcnew ArgumentNullException("encoder");
+		if (encoder->Scheduler != this)
+			throw gcnew ArgumentException("The encoder is not registered with this scheduler", "encoder");
+		// A worker waiting for its own encoder to drain would never finish it.
+		if (Array::IndexOf(workers, System::Threading::Thread::CurrentThread) >= 0)
+			throw gcnew InvalidOperationException("Unregister cannot be called from a worker thread, e.g. from an onEncoded callback");
+		// The encoder may have been registered again since an earlier Unregister, under a new ScheduledEncoder.
+		if (!encoder->Drain())
+			return;
+		System::Threading::Monitor::Enter(registered);
+		try
+		{
+			registered->Remove(encoder->Encoder);
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(registered);
+		}
+	}
+	/// <summary>
+	/// <para>Queues a frame on a registered encoder, unless the scheduler has been disposed.</para>
+	/// </summary>
+	void EncoderScheduler::Submit(ScheduledEncoder^ encoder, ScheduledFrame^ frame)
+	{
+		// Counted instead of locked, so streams submitting at once do not contend for one lock.  Dispose waits for the count to drain.
+		System::Threading::Interlocked::Increment(submitting);
+		try
+		{
+			if (isDisposed)
+				throw gcnew ObjectDisposedException("EncoderScheduler");
+			// Only an idle encoder is queued; one that is already queued or running picks up the new frame on its own.
+			if (encoder->Queue(frame))
+				Enqueue(encoder, encoder->lastWorker);
+		}
+		finally
+		{
+			System::Threading::Interlocked::Decrement(submitting);
+		}
+	}
+	void EncoderScheduler::Enqueue(ScheduledEncoder^ encoder, int worker)
+	{
+		LinkedList<ScheduledEncoder^>^ queue = queues[worker];
+		System::Threading::Monitor::Enter(queue);
+		try
+		{
+			queue->AddLast(encoder);
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(queue);
+		}
+		available->Release();
+	}
+	ScheduledEncoder^ EncoderScheduler::Take(int worker)
+	{
+		// A worker runs its own queue from the front and steals from the back of the others, so the two rarely contend for the same end.
+		for (int i = 0; i < queues->Length; i++)
+		{
+			int victim = (worker + i) % queues->Length;
+			LinkedList<ScheduledEncoder^>^ queue = queues[victim];
+			System::Threading::Monitor::Enter(queue);
+			try
+			{
+				if (queue->Count > 0)
+				{
+					ScheduledEncoder^ encoder;
+					if (victim == worker)
+					{
+						encoder = queue->First->Value;
+						queue->RemoveFirst();
+					}
+					else
+					{
+						encoder = queue->Last->Value;
+						queue->RemoveLast();
+					}
+					return encoder;
+				}
+			}
+			finally
+			{
+				System::Threading::Monitor::Exit(queue);
+			}
+		}
+		return nullptr;
+	}
+	void EncoderScheduler::Worker(Object^ index)
+	{
+		int worker = safe_cast<int>(index);
+		while (true)
+		{
+			available->Wait();
+			ScheduledEncoder^ encoder = Take(worker);
+			if (encoder == nullptr)
+			{
+				// Every Enqueue releases the semaphore once, so an empty wake can only be one of the wakes added by Dispose.
+				return;
+			}
+			if (encoder->RunTurn(worker))
+				Enqueue(encoder, worker);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+#include "X264Options.h"
+
+using namespace System;
+using namespace System::Collections::Generic;
+
+namespace x264net {
+
+	ref class X264Net;
+	ref class EncoderScheduler;
+	ref class ScheduledFrame;
+
+	/// <summary>
+	/// <para>An encoder registered with an EncoderScheduler.  Frames submitted to it are encoded in order on one of the scheduler's worker threads, and its callback receives each frame's output, also in order.</para>
+	/// </summary>
+	public ref class ScheduledEncoder
+	{
+	private:
+		EncoderScheduler^ scheduler;
+		X264Net^ encoder;
+		Action<array<Byte>^>^ onEncoded;
+		Queue<ScheduledFrame^>^ frames;
+		bool scheduled;
+		bool unregistered;
+		Exception^ fault;
+		void Submit(ScheduledFrame^ frame);
+		void Idle();
+	internal:
+		property EncoderScheduler^ Scheduler { EncoderScheduler^ get() { return scheduler; } }
+		bool Queue(ScheduledFrame^ frame);
+		bool Drain();
+		/// <summary>
+		/// <para>The worker that last ran this encoder.  It is offered the encoder first next time, since the encoder's state is likely still in that core's cache.</para>
+		/// </summary>
+		int lastWorker;
+		ScheduledEncoder(EncoderScheduler^ scheduler, X264Net^ encoder, Action<array<Byte>^>^ onEncoded, int worker);
+		bool RunTurn(int worker);
+	public:
+		/// <summary>
+		/// <para>The encoder.  Do not call its Encode methods directly while it is registered.</para>
+		/// </summary>
+		property X264Net^ Encoder { X264Net^ get() { return encoder; } }
+		/// <summary>
+		/// <para>The number of submitted frames not yet encoded.</para>
+		/// </summary>
+		property int PendingFrames { int get(); }
+		/// <summary>
+		/// <para>The exception thrown while encoding a frame or running the callback, or null.  Once set, the remaining frames are dropped and Submit rethrows it.</para>
+		/// </summary>
+		property Exception^ Fault { Exception^ get() { return fault; } }
+		/// <summary>
+		/// <para>Queues a frame to be encoded with the next automatic timestamp.  The array must not be modified until its callback has run.  Throws ObjectDisposedException once the scheduler has been disposed, and InvalidOperationException once the encoder has been unregistered.</para>
+		/// </summary>
+		void Submit(array<Byte>^ frame);
+		/// <summary>
+		/// <para>Queues a frame to be encoded with the specified timestamp.  The array must not be modified until its callback has run.  Throws ObjectDisposedException once the scheduler has been disposed, and InvalidOperationException once the encoder has been unregistered.</para>
+		/// </summary>
+		void Submit(array<Byte>^ frame, Int64 timestamp);
+	};
+
+	/// <summary>
+	/// <para>Runs many small encoders (thumbnail and preview streams) on a fixed pool of worker threads instead of one thread per stream.</para>
+	/// <para>Each registered encoder is run by at most one worker at a time, so its frames are encoded in submission order.  An encoder with work is queued on the worker that ran it last; idle workers steal queued encoders from busy ones.  Each turn encodes a few frames before the encoder goes to the back of the queue, so a busy stream cannot starve the others.</para>
+	/// <para>Encoders should be created with Threads = 1 (the default), so that x264 does its work on the scheduler's threads, and without OverlapConversion.  This instance must be disposed when you are finished with it; queued frames are encoded first.</para>
+	/// </summary>
+	public ref class EncoderScheduler
+	{
+	private:
+		array<System::Threading::Thread^>^ workers;
+		array<LinkedList<ScheduledEncoder^>^>^ queues;
+		System::Threading::SemaphoreSlim^ available;
+		HashSet<X264Net^>^ registered;
+		int nextWorker;
+		/// <summary>
+		/// <para>The number of Submit calls in progress.</para>
+		/// </summary>
+		int submitting;
+		bool isDisposed;
+		void Start(int workerCount);
+		void Worker(Object^ index);
+		ScheduledEncoder^ Take(int worker);
+	internal:
+		void Enqueue(ScheduledEncoder^ encoder, int worker);
+		void Submit(ScheduledEncoder^ encoder, ScheduledFrame^ frame);
+	public:
+		/// <summary>
+		/// <para>Create a scheduler with one worker per logical processor.</para>
+		/// </summary>
+		EncoderScheduler();
+		/// <summary>
+		/// <para>Create a scheduler with the given number of worker threads.</para>
+		/// </summary>
+		EncoderScheduler(int workerCount);
+		~EncoderScheduler();
+		/// <summary>
+		/// <para>The number of worker threads.</para>
+		/// </summary>
+		property int WorkerCount { int get() { return workers->Length; } }
+		/// <summary>
+		/// <para>Registers an encoder.  onEncoded is called on a worker thread with the output of each frame (as EncodeFrameAsWholeArray returns it), in order.  An encoder can be registered only once at a time.  The caller still owns the encoder and may dispose it after unregistering it or disposing the scheduler.</para>
+		/// </summary>
+		ScheduledEncoder^ Register(X264Net^ encoder, Action<array<Byte>^>^ onEncoded);
+		/// <summary>
+		/// <para>Unregisters an encoder when its stream ends: further Submit calls throw, the frames already submitted are encoded, and then the scheduler lets go of the encoder.  Blocks until those frames are done, so it must not be called from a worker thread (e.g. an onEncoded callback).</para>
+		/// </summary>
+		void Unregister(ScheduledEncoder^ encoder);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "FrameBroadcaster.h"
+#include "x264net.h"
+namespace x264net
+{
+	EncodedFrame::EncodedFrame(EncodedBuffer* buffer, int64_t sequence, bool discontinuity) : buffer(buffer), sequence(sequence), discontinuity(discontinuity)
+	{
+	}
+	EncodedFrame::~EncodedFrame()
+	{
+		this->!EncodedFrame();
+	}
+	EncodedFrame::!EncodedFrame()
+	{
+		if (buffer)
+		{
+			buffer->Release();
+			buffer = NULL;
+		}
+	}
+	void EncodedFrame::ThrowIfDisposed()
+	{
+		if (!buffer)
+			throw gcnew ObjectDisposedException("EncodedFrame");
+	}
+	int EncodedFrame::Length::get()
+	{
+		ThrowIfDisposed();
+		return buffer->size;
+	}
+	IntPtr EncodedFrame::Data::get()
+	{
+		ThrowIfDisposed();
+		return (IntPtr)buffer->data;
+	}
+	Int64 EncodedFrame::Pts::get()
+	{
+		ThrowIfDisposed();
+		return buffer->pts;
+	}
+	Int64 EncodedFrame::Dts::get()
+	{
+		ThrowIfDisposed();
+		return buffer->dts;
+	}
+	bool EncodedFrame::IsKeyframe::get()
+	{
+		ThrowIfDisposed();
+		return buffer->keyframe;
+	}
+	void EncodedFrame::CopyTo(array<Byte>^ destination, int offset)
+	{
+		ThrowIfDisposed();
+		System::Runtime::InteropServices::Marshal::Copy((IntPtr)buffer->data, destination, offset, buffer->size);
+	}
+	array<Byte>^ EncodedFrame::ToArray()
+	{
+		ThrowIfDisposed();
+		array<Byte>^ copy = gcnew array<Byte>(buffer->size);
+		System::Runtime::InteropServices::Marshal::Copy((IntPtr)buffer->data, copy, 0, buffer->size);
+		return copy;
+	}
+
+	FrameSubscription::FrameSubscription(BroadcastRing* ring, int maxLag) : ring(ring), MaxLag(maxLag)
+	{
+		ring->AddRef();
+		dropped = 0;
+		pendingDiscontinuity = false;
+		int64_t head = ring->Head();
+		int64_t keyframe = ring->LastKeyframe();
+		if (keyframe >= 0 && head - keyframe <= Math::Min(Math::Max(maxLag, 1), ring->Capacity() - 1))
+		{
+			next = keyframe;
+			waitingForKeyframe = false;
+		}
+		else
+		{
+			next = head;
+			waitingForKeyframe = true;
+		}
+	}
+	FrameSubscription::~FrameSubscription()
+	{
+		this->!FrameSubscription();
+	}
+	FrameSubscription::!FrameSubscription()
+	{
+		if (ring)
+		{
+			ring->Release();
+			ring = NULL;
+		}
+	}
+	Int64 FrameSubscription::Lag::get()
+	{
+		if (!ring)
+			throw gcnew ObjectDisposedException("FrameSubscription");
+		return ring->Head() - next;
+	}
+	EncodedFrame^ FrameSubscription::TryRead()
+	{
+		if (!ring)
+			throw gcnew ObjectDisposedException("FrameSubscription");
+		int maxLag = Math::Min(Math::Max(MaxLag, 1), ring->Capacity() - 1);
+		while (true)
+		{
+			if (waitingForKeyframe)
+			{
+				int64_t keyframe = ring->LastKeyframe();
+				if (keyframe < next)
+				{
+					// Nothing decodable yet; skip whatever has been published since we started waiting.
+					int64_t head = ring->Head();
+					dropped += head - next;
+					next = head;
+					return nullptr;
+				}
+				dropped += keyframe - next;
+				next = keyframe;
+				waitingForKeyframe = false;
+			}
+			if (ring->Head() - next > maxLag)
+			{
+				SkipAhead();
+				continue;
+			}
+			EncodedBuffer* buffer;
+			BroadcastRing::ReadStatus status = ring->TryRead(next, &buffer);
+			if (status == BroadcastRing::ReadEmpty)
+				return nullptr;
+			if (status == BroadcastRing::ReadOverrun)
+			{
+				SkipAhead();
+				continue;
+			}
+			EncodedFrame^ frame = gcnew EncodedFrame(buffer, next, pendingDiscontinuity);
+			pendingDiscontinuity = false;
+			next++;
+			return frame;
+		}
+	}
+	void FrameSubscription::SkipAhead()
+	{
+		// Resume at the most recent keyframe if it is close enough to the head to be read safely,
+		// otherwise drop everything and wait for the next one.
+		int maxLag = Math::Min(Math::Max(MaxLag, 1), ring->Capacity() - 1);
+		int64_t head = ring->Head();
+		int64_t keyframe = ring->LastKeyframe();
+		pendingDiscontinuity = true;
+		if (keyframe > next && head - keyframe <= maxLag)
+		{
+			dropped += keyframe - next;
+			next = keyframe;
+		}
+		else
+		{
+			dropped += head - next;
+			next = head;
+			waitingForKeyframe = true;
+		}
+	}
+
+	/// <summary>
+	/// <para>Create a broadcaster and attach it to an encoder.  From now on, every frame the encoder produces is published to this broadcaster's subscribers.</para>
+	/// <para>An encoder can have only one broadcaster attached at a time.  Do not attach or dispose a broadcaster while the encoder is encoding a frame.</para>
+	/// </summary>
+	/// <param name="encoder">The encoder whose output should be published.</param>
+	/// <param name="capacity">The number of frames to hold.  Subscribers which fall this far behind will have frames dropped.  To let new subscribers start at the last keyframe, use at least IframeInterval.</param>
+	FrameBroadcaster::FrameBroadcaster(X264Net^ encoder, int capacity) : encoder(encoder)
+	{
+		if (capacity < 2)
+			throw gcnew ArgumentOutOfRangeException("capacity", "capacity must be at least 2");
+		if (!encoder->BufferPool)
+			throw gcnew ObjectDisposedException("X264Net");
+		ring = new BroadcastRing(capacity, encoder->BufferPool);
+		encoder->AttachBroadcastRing(ring);
+	}
+	FrameBroadcaster::~FrameBroadcaster()
+	{
+		if (ring)
+			encoder->DetachBroadcastRing(ring);
+		this->!FrameBroadcaster();
+	}
+	FrameBroadcaster::!FrameBroadcaster()
+	{
+		// The encoder and any remaining subscriptions hold their own references to the ring.
+		if (ring)
+		{
+			ring->Release();
+			ring = NULL;
+		}
+	}
+	FrameSubscription^ FrameBroadcaster::Subscribe()
+	{
+		if (!ring)
+			throw gcnew ObjectDisposedException("FrameBroadcaster");
+		return gcnew FrameSubscription(ring, ring->Capacity() - 1);
+	}
+	FrameSubscription^ FrameBroadcaster::Subscribe(int maxLag)
+	{
+		if (!ring)
+			throw gcnew ObjectDisposedException("FrameBroadcaster");
+		return gcnew FrameSubscription(ring, maxLag);
+	}
+	int FrameBroadcaster::Capacity::get()
+	{
+		if (!ring)
+			throw gcnew ObjectDisposedException("FrameBroadcaster");
+		return ring->Capacity();
+	}
+	Int64 FrameBroadcaster::PublishedFrames::get()
+	{
+		if (!ring)
+			throw gcnew ObjectDisposedException("FrameBroadcaster");
+		return ring->Head();
+	}
+}
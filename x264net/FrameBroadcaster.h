@@ -0,0 +1,133 @@
+#pragma once
+#include "stdint.h"
+#include "BroadcastRing.h"
+
+using namespace System;
+
+namespace x264net {
+
+	ref class X264Net;
+
+	/// <summary>
+	/// <para>A read-only handle to one encoded frame (one or more H.264 NAL units) held in native memory and shared by every subscriber.  The data is never copied unless you ask for a copy.</para>
+	/// <para>Each instance must be disposed when you are finished with it, so the native buffer can be recycled.</para>
+	/// </summary>
+	public ref class EncodedFrame
+	{
+	private:
+		EncodedBuffer* buffer;
+		int64_t sequence;
+		bool discontinuity;
+		!EncodedFrame();
+		void ThrowIfDisposed();
+	internal:
+		EncodedFrame(EncodedBuffer* buffer, int64_t sequence, bool discontinuity);
+	public:
+		~EncodedFrame();
+		/// <summary>
+		/// <para>The number of bytes of H.264 data.</para>
+		/// </summary>
+		property int Length { int get(); }
+		/// <summary>
+		/// <para>A pointer to the H.264 data.  Valid only until this EncodedFrame is disposed.  The memory is shared with other subscribers and must not be modified.</para>
+		/// </summary>
+		property IntPtr Data { IntPtr get(); }
+		/// <summary>
+		/// <para>The presentation timestamp x264 reported for this frame.</para>
+		/// </summary>
+		property Int64 Pts { Int64 get(); }
+		/// <summary>
+		/// <para>The decode timestamp x264 reported for this frame.</para>
+		/// </summary>
+		property Int64 Dts { Int64 get(); }
+		/// <summary>
+		/// <para>True if this frame is a keyframe (an IDR frame, or the start of an intra refresh).  A decoder can begin decoding here.</para>
+		/// </summary>
+		property bool IsKeyframe { bool get(); }
+		/// <summary>
+		/// <para>The position of this frame in the broadcast.  Increases by 1 for each published frame.</para>
+		/// </summary>
+		property Int64 Sequence { Int64 get() { return sequence; } }
+		/// <summary>
+		/// <para>True if one or more frames were dropped between this frame and the previous frame read by the same subscription.</para>
+		/// </summary>
+		property bool Discontinuity { bool get() { return discontinuity; } }
+		/// <summary>
+		/// <para>Copies the H.264 data into the destination array, starting at the given offset.</para>
+		/// </summary>
+		void CopyTo(array<Byte>^ destination, int offset);
+		/// <summary>
+		/// <para>Copies the H.264 data into a new array.</para>
+		/// </summary>
+		array<Byte>^ ToArray();
+	};
+
+	/// <summary>
+	/// <para>One subscriber's read position in a FrameBroadcaster.  Reading never blocks the encoder or other subscribers.</para>
+	/// <para>A subscriber that falls more than MaxLag frames behind (or behind the broadcaster's capacity) has frames dropped: it skips ahead to the most recent keyframe if one is still available, otherwise to the next keyframe published.</para>
+	/// <para>A subscription is meant to be read by one thread at a time.  Each instance must be disposed when you are finished with it.</para>
+	/// </summary>
+	public ref class FrameSubscription
+	{
+	private:
+		BroadcastRing* ring;
+		int64_t next;
+		int64_t dropped;
+		bool waitingForKeyframe;
+		bool pendingDiscontinuity;
+		!FrameSubscription();
+		void SkipAhead();
+	internal:
+		FrameSubscription(BroadcastRing* ring, int maxLag);
+	public:
+		~FrameSubscription();
+		/// <summary>
+		/// <para>If this many frames are waiting to be read, the subscriber is considered too slow and frames are dropped.  Must be less than the broadcaster's capacity.</para>
+		/// </summary>
+		int MaxLag;
+		/// <summary>
+		/// <para>Returns the next frame for this subscriber, or null if no new frame has been published.  The returned frame must be disposed.</para>
+		/// </summary>
+		EncodedFrame^ TryRead();
+		/// <summary>
+		/// <para>The number of published frames this subscriber has not read yet.</para>
+		/// </summary>
+		property Int64 Lag { Int64 get(); }
+		/// <summary>
+		/// <para>The total number of frames skipped because this subscriber fell too far behind.</para>
+		/// </summary>
+		property Int64 DroppedFrames { Int64 get() { return dropped; } }
+	};
+
+	/// <summary>
+	/// <para>Publishes each frame encoded by an X264Net exactly once, as an immutable reference-counted native buffer, to any number of subscribers.  Fan-out cost does not depend on frame size or subscriber count.</para>
+	/// <para>Frames are published by X264Net.EncodeFrame, EncodeFrameAsWholeArray, and PublishFrame.  Use PublishFrame if you do not need a managed copy of the output.</para>
+	/// <para>This instance must be disposed when you are finished with it.</para>
+	/// </summary>
+	public ref class FrameBroadcaster
+	{
+	private:
+		X264Net^ encoder;
+		BroadcastRing* ring;
+		!FrameBroadcaster();
+	public:
+		FrameBroadcaster(X264Net^ encoder, int capacity);
+		~FrameBroadcaster();
+		/// <summary>
+		/// <para>Creates a subscription which starts at the most recent keyframe still held by the broadcaster (so the subscriber can begin decoding immediately), or at the next keyframe if there is none.</para>
+		/// </summary>
+		FrameSubscription^ Subscribe();
+		/// <summary>
+		/// <para>Creates a subscription with the given MaxLag.  See Subscribe().</para>
+		/// </summary>
+		FrameSubscription^ Subscribe(int maxLag);
+		/// <summary>
+		/// <para>The number of frames held by the broadcaster.  Subscribers can lag behind by less than this many frames.</para>
+		/// </summary>
+		property int Capacity { int get(); }
+		/// <summary>
+		/// <para>The number of frames published so far.</para>
+		/// </summary>
+		property Int64 PublishedFrames { Int64 get(); }
+	};
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "stdint.h"
+#pragma managed( push, off )
+#include <cstddef>
+#include <cstring>
+#pragma managed( pop )
+
+#pragma managed( push, off )
+namespace x264net
+{
+	/// <summary>
+	/// <para>Computes a 64-bit hash of a frame's raw data, used to recognize frames that are byte-identical to the previous one.</para>
+	/// <para>Four independent multiply-rotate lanes each consume 8 bytes per step, so the hash runs at close to memory bandwidth, far cheaper than a color conversion.  It is not cryptographic; the chance of two different frames colliding is about 1 in 2^64.</para>
+	/// </summary>
+	inline uint64_t HashFrame(const uint8_t* data, size_t size)
+	{
+		const uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+		const uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+		uint64_t lanes[4] = { Prime1, Prime2, Prime1 ^ Prime2, ~Prime1 };
+		size_t i = 0;
+		for (; i + 32 <= size; i += 32)
+		{
+			for (int lane = 0; lane < 4; lane++)
+			{
+				uint64_t word;
+				memcpy(&word, data + i + lane * 8, 8);
+				uint64_t mixed = lanes[lane] + word * Prime2;
+				lanes[lane] = ((mixed << 31) | (mixed >> 33)) * Prime1;
+			}
+		}
+		uint64_t hash = (uint64_t)size;
+		for (int lane = 0; lane < 4; lane++)
+			hash = ((hash ^ lanes[lane]) * Prime1) + Prime2;
+		for (; i < size; i++)
+			hash = (hash ^ data[i]) * Prime1;
+		hash ^= hash >> 29;
+		hash *= Prime2;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	/// <summary>
+	/// <para>Hashes an image whose rows of rowBytes bytes start stride bytes apart (as for a region of a larger image), ignoring any padding between rows.</para>
+	/// </summary>
+	inline uint64_t HashImage(const uint8_t* data, int stride, int rowBytes, int height)
+	{
+		if (stride == rowBytes)
+			return HashFrame(data, (size_t)rowBytes * height);
+		uint64_t hash = 0;
+		for (int y = 0; y < height; y++)
+			hash = (hash * 0x9E3779B185EBCA87ULL) ^ HashFrame(data + (ptrdiff_t)y * stride, rowBytes);
+		return hash;
+	}
+}
+#pragma managed( pop )
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+#include "stdint.h"
+#pragma managed( push, off )
+#include <vector>
+#pragma managed( pop )
+
+#pragma managed( push, off )
+namespace x264net
+{
+	/// <summary>
+	/// <para>Per-frame metadata carried through x264 in x264_picture_t.opaque, so that output can be matched to its input even when x264 delays frames (B-frames, lookahead, frame threads).</para>
+	/// <para>Times are Stopwatch timestamps.</para>
+	/// </summary>
+	struct FrameRecord
+	{
+		/// <summary>The caller's token for this frame.</summary>
+		int64_t token;
+		/// <summary>When the frame was submitted to X264Net.</summary>
+		int64_t submitted;
+		/// <summary>When the frame (converted to YUV) was handed to x264_encoder_encode.</summary>
+		int64_t queued;
+		/// <summary>When the x264_encoder_encode call that returned this frame's output started.</summary>
+		int64_t encodeStarted;
+		/// <summary>When the x264_encoder_encode call that returned this frame's output finished.</summary>
+		int64_t encodeFinished;
+		FrameRecord* nextFree;
+	};
+
+	/// <summary>
+	/// <para>Recycles FrameRecords.  Only as many records exist as x264 holds frames at once, plus one.  Records still inside x264 when the pool is destroyed are freed with it.  Not thread safe; used only by the encoding thread.</para>
+	/// </summary>
+	class FrameRecordPool
+	{
+	public:
+		FrameRecordPool() : freeList(NULL)
+		{
+		}
+		~FrameRecordPool()
+		{
+			for (size_t i = 0; i < all.size(); i++)
+				delete all[i];
+		}
+		FrameRecord* Acquire()
+		{
+			FrameRecord* record = freeList;
+			if (record)
+				freeList = record->nextFree;
+			else
+			{
+				record = new FrameRecord();
+				all.push_back(record);
+			}
+			record->nextFree = NULL;
+			return record;
+		}
+		void Return(FrameRecord* record)
+		{
+			record->nextFree = freeList;
+			freeList = record;
+		}
+	private:
+		std::vector<FrameRecord*> all;
+		FrameRecord* freeList;
+		FrameRecordPool(const FrameRecordPool&);
+		FrameRecordPool& operator=(const FrameRecordPool&);
+	};
+}
+#pragma managed( pop )
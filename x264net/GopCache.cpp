@@ -0,0 +1,123 @@
+#include "GopCache.h"
+
+#pragma managed( push, off )
+namespace x264net
+{
+	GopCache::GopCache(int capacity) : capacity(capacity < 1 ? 1 : capacity), start(0), count(0), valid(false), headers(NULL)
+	{
+		ring = new EncodedBuffer*[this->capacity]();
+	}
+	GopCache::~GopCache()
+	{
+		ClearUnlocked();
+		if (headers)
+			headers->Release();
+		delete[] ring;
+	}
+	void GopCache::SetHeaders(const uint8_t* data, int size)
+	{
+		EncodedBuffer* newHeaders = EncodedBuffer::Create(data, size);
+		if (newHeaders)
+			newHeaders->hasParameterSets = true;
+		EncodedBuffer* oldHeaders;
+		{
+			SpinLockGuard guard(lock);
+			oldHeaders = headers;
+			headers = newHeaders;
+		}
+		if (oldHeaders)
+			oldHeaders->Release();
+	}
+	void GopCache::Add(EncodedBuffer* buffer)
+	{
+		// Buffers that fall out of the cache are released outside the lock.
+		std::vector<EncodedBuffer*> evicted;
+		buffer->AddRef();
+		{
+			SpinLockGuard guard(lock);
+			if (buffer->keyframe)
+			{
+				for (int i = 0; i < count; i++)
+				{
+					evicted.push_back(ring[(start + i) % capacity]);
+					ring[(start + i) % capacity] = NULL;
+				}
+				start = 0;
+				count = 0;
+				valid = true;
+			}
+			if (!valid)
+			{
+				// Still waiting for the first keyframe (or for the one after an overflow).
+				evicted.push_back(buffer);
+			}
+			else if (count == capacity)
+			{
+				// This GOP is longer than the cache.  A partial GOP is undecodable, so drop all of it.
+				for (int i = 0; i < count; i++)
+				{
+					evicted.push_back(ring[(start + i) % capacity]);
+					ring[(start + i) % capacity] = NULL;
+				}
+				start = 0;
+				count = 0;
+				valid = false;
+				evicted.push_back(buffer);
+			}
+			else
+			{
+				ring[(start + count) % capacity] = buffer;
+				count++;
+			}
+		}
+		for (size_t i = 0; i < evicted.size(); i++)
+			evicted[i]->Release();
+	}
+	bool GopCache::Snapshot(std::vector<EncodedBuffer*>& output)
+	{
+		SpinLockGuard guard(lock);
+		if (!valid || count == 0)
+			return false;
+		if (!ring[start]->hasParameterSets && headers)
+		{
+			headers->AddRef();
+			output.push_back(headers);
+		}
+		for (int i = 0; i < count; i++)
+		{
+			EncodedBuffer* buffer = ring[(start + i) % capacity];
+			buffer->AddRef();
+			output.push_back(buffer);
+		}
+		return true;
+	}
+	void GopCache::Clear()
+	{
+		std::vector<EncodedBuffer*> evicted;
+		{
+			SpinLockGuard guard(lock);
+			for (int i = 0; i < count; i++)
+			{
+				evicted.push_back(ring[(start + i) % capacity]);
+				ring[(start + i) % capacity] = NULL;
+			}
+			start = 0;
+			count = 0;
+			valid = false;
+		}
+		for (size_t i = 0; i < evicted.size(); i++)
+			evicted[i]->Release();
+	}
+	void GopCache::ClearUnlocked()
+	{
+		for (int i = 0; i < count; i++)
+		{
+			ring[(start + i) % capacity]->Release();
+			ring[(start + i) % capacity] = NULL;
+		}
+		start = 0;
+		count = 0;
+		valid = false;
+	}
+}
+#pragma managed( pop )
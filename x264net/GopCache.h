@@ -0,0 +1,53 @@
+#pragma once
+#include "EncodedBuffer.h"
+#include "SpinLock.h"
+#pragma managed( push, off )
+#include <vector>
+#pragma managed( pop )
+
+#pragma managed( push, off )
+namespace x264net
+{
+	/// <summary>
+	/// <para>Keeps every access unit produced since the most recent keyframe (IDR, or intra refresh recovery point) so that a viewer who joins mid-stream can begin decoding immediately.</para>
+	/// <para>Access units are held in a fixed-size ring of reference-counted buffers.  Add() is called by the encoding thread; Snapshot() may be called from any thread.</para>
+	/// </summary>
+	class GopCache
+	{
+	public:
+		/// <summary>
+		/// <para>Creates a cache which can hold up to capacity access units.  If a GOP grows longer than this, the cache is unusable until the next keyframe arrives.</para>
+		/// </summary>
+		explicit GopCache(int capacity);
+		~GopCache();
+		/// <summary>
+		/// <para>Remembers the stream's SPS and PPS (as returned by x264_encoder_headers), for use when a cached keyframe does not carry its own.</para>
+		/// </summary>
+		void SetHeaders(const uint8_t* data, int size);
+		/// <summary>
+		/// <para>Adds an access unit to the cache.  A keyframe discards everything cached before it.  The cache takes its own reference to the buffer.</para>
+		/// </summary>
+		void Add(EncodedBuffer* buffer);
+		/// <summary>
+		/// <para>Appends the cached access units to output, oldest first, preceded by the SPS and PPS if the keyframe lacks them.  Each buffer appended has been given a reference which the caller must Release().</para>
+		/// <para>Returns false (appending nothing) if no complete GOP is cached.</para>
+		/// </summary>
+		bool Snapshot(std::vector<EncodedBuffer*>& output);
+		/// <summary>
+		/// <para>Releases every cached access unit.</para>
+		/// </summary>
+		void Clear();
+	private:
+		void ClearUnlocked();
+		EncodedBuffer** ring;
+		int capacity;
+		int start;
+		int count;
+		bool valid;
+		EncodedBuffer* headers;
+		SpinLock lock;
+		GopCache(const GopCache&);
+		GopCache& operator=(const GopCache&);
+	};
+}
+#pragma managed( pop )
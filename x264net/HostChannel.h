@@ -0,0 +1,298 @@
+#pragma once
+#include "stdint.h"
+#pragma managed( push, off )
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#pragma managed( pop )
+
+#pragma managed( push, off )
+namespace x264net
+{
+	/// <summary>
+	/// <para>The control block at the start of the shared memory between a RemoteEncoder and its host process.</para>
+	/// <para>Frames travel through a ring of fixed-size slots: the client fills slot framesWritten % slotCount and advances framesWritten, and the host encodes straight out of the slot and advances framesRead.  Encoded output comes back through a byte ring of HostOutputRecords, advanced the same way by outputWritten and outputRead.  Each counter is written by one side only and never wraps, so no locks are needed.</para>
+	/// </summary>
+	struct HostChannelHeader
+	{
+		static const uint32_t Signature = 0x34363258;
+		uint32_t signature;
+		int32_t slotCount;
+		/// <summary>Bytes of frame data in each slot.</summary>
+		int32_t slotSize;
+		/// <summary>Bytes in the output ring.  A multiple of 8.</summary>
+		int32_t outputCapacity;
+		/// <summary>Bytes of serialized X264Options following this header.</summary>
+		int32_t optionsSize;
+		/// <summary>0 while the host is starting, 1 once its encoder is open, -1 if it could not open one (error holds the reason).</summary>
+		std::atomic<int32_t> hostState;
+		std::atomic<int64_t> framesWritten;
+		std::atomic<int64_t> framesRead;
+		std::atomic<int64_t> outputWritten;
+		std::atomic<int64_t> outputRead;
+		char error[1024];
+	};
+
+	enum HostFrameFlags
+	{
+		HostFrameHasTimestamp = 1,
+		/// <summary>Not a frame: the host flushes its encoder.</summary>
+		HostFrameFlush = 2,
+		/// <summary>Not a frame: the host closes its encoder and exits.</summary>
+		HostFrameStop = 4
+	};
+
+	/// <summary>
+	/// <para>The header of an input slot.  The frame data follows it, laid out exactly as the byte array passed to X264Net.EncodeFrame would be.</para>
+	/// </summary>
+	struct HostFrameSlot
+	{
+		int64_t timestamp;
+		int32_t flags;
+		int32_t reserved;
+	};
+
+	enum HostOutputFlags
+	{
+		/// <summary>Padding to the end of the ring; the next record is at the start.</summary>
+		HostOutputWrap = 1,
+		/// <summary>The output of a flush request.</summary>
+		HostOutputFlushed = 2,
+		/// <summary>The request failed; the payload is the UTF-8 error message.</summary>
+		HostOutputError = 4
+	};
+
+	/// <summary>
+	/// <para>The header of one output record: the encoder's output for one input slot, possibly empty.  The payload follows it, and the record is padded to 8 bytes.</para>
+	/// </summary>
+	struct HostOutputRecord
+	{
+		int32_t size;
+		int32_t flags;
+		/// <summary>The index of the input slot this output answers.</summary>
+		int64_t frame;
+	};
+
+	/// <summary>
+	/// <para>Reads and writes the rings in a mapped HostChannelHeader.  Either process can create one over its own mapping of the memory.</para>
+	/// </summary>
+	class HostChannel
+	{
+	public:
+		static size_t TotalSize(int slotCount, int slotSize, int outputCapacity, int optionsSize)
+		{
+			return SlotsOffset(optionsSize) + SlotStride(slotSize) * slotCount + outputCapacity;
+		}
+		explicit HostChannel(uint8_t* base) : base(base), header((HostChannelHeader*)base)
+		{
+		}
+		/// <summary>
+		/// <para>Lays out fresh shared memory.  Called by the client before it starts the host.</para>
+		/// </summary>
+		void Initialize(int slotCount, int slotSize, int outputCapacity, const uint8_t* options, int optionsSize)
+		{
+			new (header) HostChannelHeader();
+			header->signature = HostChannelHeader::Signature;
+			header->slotCount = slotCount;
+			header->slotSize = slotSize;
+			header->outputCapacity = outputCapacity;
+			header->optionsSize = optionsSize;
+			header->hostState.store(0, std::memory_order_relaxed);
+			header->framesWritten.store(0, std::memory_order_relaxed);
+			header->framesRead.store(0, std::memory_order_relaxed);
+			header->outputWritten.store(0, std::memory_order_relaxed);
+			header->outputRead.store(0, std::memory_order_relaxed);
+			header->error[0] = 0;
+			memcpy(base + OptionsOffset(), options, optionsSize);
+		}
+		bool IsValid() const
+		{
+			return header->signature == HostChannelHeader::Signature;
+		}
+		const uint8_t* Options() const
+		{
+			return base + OptionsOffset();
+		}
+		int OptionsSize() const
+		{
+			return header->optionsSize;
+		}
+		int SlotSize() const
+		{
+			return header->slotSize;
+		}
+		int HostState() const
+		{
+			return header->hostState.load(std::memory_order_acquire);
+		}
+		const char* Error() const
+		{
+			return header->error;
+		}
+		/// <summary>
+		/// <para>Host: records the outcome of opening the encoder.  message may be NULL on success.</para>
+		/// </summary>
+		void SetHostState(int state, const char* message)
+		{
+			if (message)
+			{
+				strncpy(header->error, message, sizeof(header->error) - 1);
+				header->error[sizeof(header->error) - 1] = 0;
+			}
+			header->hostState.store(state, std::memory_order_release);
+		}
+
+		// Input ring
+
+		/// <summary>
+		/// <para>The number of slots written by the client and not yet finished by the host.</para>
+		/// </summary>
+		int64_t FramesInFlight() const
+		{
+			return header->framesWritten.load(std::memory_order_acquire) - header->framesRead.load(std::memory_order_acquire);
+		}
+		/// <summary>
+		/// <para>Client: the index of the next slot to fill, or -1 if every slot is still in use.</para>
+		/// </summary>
+		int64_t NextFreeSlot() const
+		{
+			int64_t written = header->framesWritten.load(std::memory_order_relaxed);
+			if (written - header->framesRead.load(std::memory_order_acquire) >= header->slotCount)
+				return -1;
+			return written;
+		}
+		/// <summary>
+		/// <para>Host: the index of the next slot to encode, or -1 if the client has not written one.</para>
+		/// </summary>
+		int64_t NextFullSlot() const
+		{
+			int64_t read = header->framesRead.load(std::memory_order_relaxed);
+			if (read == header->framesWritten.load(std::memory_order_acquire))
+				return -1;
+			return read;
+		}
+		HostFrameSlot* Slot(int64_t index) const
+		{
+			return (HostFrameSlot*)(base + SlotsOffset(header->optionsSize) + SlotStride(header->slotSize) * (size_t)(index % header->slotCount));
+		}
+		uint8_t* SlotData(int64_t index) const
+		{
+			return (uint8_t*)(Slot(index) + 1);
+		}
+		/// <summary>
+		/// <para>Client: hands the next slot to the host.</para>
+		/// </summary>
+		void CommitSlot(int64_t timestamp, int flags)
+		{
+			int64_t written = header->framesWritten.load(std::memory_order_relaxed);
+			HostFrameSlot* slot = Slot(written);
+			slot->timestamp = timestamp;
+			slot->flags = flags;
+			header->framesWritten.store(written + 1, std::memory_order_release);
+		}
+		/// <summary>
+		/// <para>Host: returns the oldest slot to the client.</para>
+		/// </summary>
+		void ReleaseSlot()
+		{
+			header->framesRead.fetch_add(1, std::memory_order_release);
+		}
+
+		// Output ring
+
+		/// <summary>
+		/// <para>True if a record with this much payload could ever fit in the output ring.</para>
+		/// </summary>
+		bool OutputFits(int size) const
+		{
+			return RecordSize(size) <= (size_t)header->outputCapacity;
+		}
+		/// <summary>
+		/// <para>Host: appends an output record, or returns false if the client has not yet read enough of the ring to make room for it.</para>
+		/// </summary>
+		bool TryWriteOutput(const uint8_t* data, int size, int flags, int64_t frame)
+		{
+			int64_t written = header->outputWritten.load(std::memory_order_relaxed);
+			int64_t capacity = header->outputCapacity;
+			int64_t position = written % capacity;
+			int64_t recordSize = (int64_t)RecordSize(size);
+			int64_t padding = capacity - position < recordSize ? capacity - position : 0;
+			if (written + padding + recordSize - header->outputRead.load(std::memory_order_acquire) > capacity)
+				return false;
+			if (padding >= (int64_t)sizeof(HostOutputRecord))
+			{
+				HostOutputRecord* wrap = (HostOutputRecord*)(OutputRing() + position);
+				wrap->size = 0;
+				wrap->flags = HostOutputWrap;
+				wrap->frame = frame;
+			}
+			HostOutputRecord* record = (HostOutputRecord*)(OutputRing() + (padding ? 0 : position));
+			record->size = size;
+			record->flags = flags;
+			record->frame = frame;
+			if (size > 0)
+				memcpy(record + 1, data, size);
+			header->outputWritten.store(written + padding + recordSize, std::memory_order_release);
+			return true;
+		}
+		/// <summary>
+		/// <para>Client: returns the oldest unread output record, or NULL if there is none.  The record stays valid until ConsumeOutput is called.</para>
+		/// </summary>
+		const HostOutputRecord* PeekOutput()
+		{
+			int64_t capacity = header->outputCapacity;
+			while (true)
+			{
+				int64_t read = header->outputRead.load(std::memory_order_relaxed);
+				if (read == header->outputWritten.load(std::memory_order_acquire))
+					return NULL;
+				int64_t position = read % capacity;
+				// The writer leaves a gap too small for a record header, or marks a larger one, when the next record would not fit before the end.
+				if (capacity - position < (int64_t)sizeof(HostOutputRecord) || ((HostOutputRecord*)(OutputRing() + position))->flags & HostOutputWrap)
+				{
+					header->outputRead.store(read + capacity - position, std::memory_order_release);
+					continue;
+				}
+				return (HostOutputRecord*)(OutputRing() + position);
+			}
+		}
+		/// <summary>
+		/// <para>Client: frees the record returned by PeekOutput.</para>
+		/// </summary>
+		void ConsumeOutput(const HostOutputRecord* record)
+		{
+			header->outputRead.fetch_add((int64_t)RecordSize(record->size), std::memory_order_release);
+		}
+	private:
+		static size_t Align(size_t size, size_t alignment)
+		{
+			return (size + alignment - 1) / alignment * alignment;
+		}
+		static size_t OptionsOffset()
+		{
+			return Align(sizeof(HostChannelHeader), 64);
+		}
+		static size_t SlotsOffset(int optionsSize)
+		{
+			return Align(OptionsOffset() + optionsSize, 64);
+		}
+		static size_t SlotStride(int slotSize)
+		{
+			return Align(sizeof(HostFrameSlot) + slotSize, 64);
+		}
+		static size_t RecordSize(int size)
+		{
+			return Align(sizeof(HostOutputRecord) + size, 8);
+		}
+		uint8_t* OutputRing() const
+		{
+			return base + SlotsOffset(header->optionsSize) + SlotStride(header->slotSize) * header->slotCount;
+		}
+		uint8_t* base;
+		HostChannelHeader* header;
+		HostChannel(const HostChannel&);
+		HostChannel& operator=(const HostChannel&);
+	};
+}
+#pragma managed( pop )
\ No newline at end of file
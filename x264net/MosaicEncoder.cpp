@@ -0,0 +1,123 @@
+#include "MosaicEncoder.h"
+#include "x264net.h"
+namespace x264net
+{
+	MosaicEncoder::MosaicEncoder(X264Options^ options) : Options(options)
+	{
+		if (options->PictureFormat != X264PictureFormat::I420)
+			throw gcnew ArgumentException("MosaicEncoder requires PictureFormat I420. Provided value: " + options->PictureFormat.ToString(), "options");
+		if (options->OverlapConversion)
+			throw gcnew ArgumentException("MosaicEncoder does not support OverlapConversion, because its regions are drawn into a single input picture.", "options");
+		isDisposed = false;
+		regions = gcnew System::Collections::Generic::List<IntPtr>();
+		encoder = gcnew X264Net(options);
+		encoder->ownedByMosaic = true;
+		// Everything outside the regions, and every region until it receives input, is black.
+		x264_picture_t* picture = encoder->InputPicture;
+		MosaicRegion canvas(0, 0, options->Width, options->Height);
+		canvas.Clear(options->FullRange, picture->img.plane, picture->img.i_stride);
+	}
+	MosaicEncoder::~MosaicEncoder()
+	{
+		// This method appears as "Dispose()" in C#.
+		if (encoder != nullptr)
+			delete encoder;
+		encoder = nullptr;
+		this->!MosaicEncoder();
+	}
+	MosaicEncoder::!MosaicEncoder()
+	{
+		if (isDisposed)
+			return;
+		for (int i = 0; i < regions->Count; i++)
+			delete (MosaicRegion*)regions[i].ToPointer();
+		regions->Clear();
+		isDisposed = true;
+	}
+	int MosaicEncoder::AddRegion(int x, int y, int width, int height)
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("MosaicEncoder");
+		if (x % 2 != 0 || y % 2 != 0 || width % 2 != 0 || height % 2 != 0)
+			throw gcnew ArgumentException("Region position and size must be even numbers. Provided region: " + width + " x " + height + " at " + x + ", " + y);
+		if (x < 0 || y < 0 || width < 2 || height < 2 || x + width > Options->Width || y + height > Options->Height)
+			throw gcnew ArgumentException("Region " + width + " x " + height + " at " + x + ", " + y + " does not fit inside the " + Options->Width + " x " + Options->Height + " mosaic");
+		regions->Add((IntPtr)new MosaicRegion(x, y, width, height));
+		return regions->Count - 1;
+	}
+	int MosaicEncoder::AddGrid(int columns, int rows)
+	{
+		if (columns < 1 || rows < 1)
+			throw gcnew ArgumentException("A grid requires at least 1 column and 1 row. Provided values: " + columns + " x " + rows);
+		int first = regions->Count;
+		for (int row = 0; row < rows; row++)
+		{
+			// Boundaries are rounded down to even pixels; any leftover pixels stay black.
+			int y = (int)((int64_t)Options->Height * row / rows) & ~1;
+			int height = ((int)((int64_t)Options->Height * (row + 1) / rows) & ~1) - y;
+			for (int column = 0; column < columns; column++)
+			{
+				int x = (int)((int64_t)Options->Width * column / columns) & ~1;
+				int width = ((int)((int64_t)Options->Width * (column + 1) / columns) & ~1) - x;
+				AddRegion(x, y, width, height);
+			}
+		}
+		return first;
+	}
+	MosaicRegion* MosaicEncoder::GetRegion(int region)
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("MosaicEncoder");
+		if (region < 0 || region >= regions->Count)
+			throw gcnew ArgumentOutOfRangeException("region");
+		return (MosaicRegion*)regions[region].ToPointer();
+	}
+	void MosaicEncoder::SetInput(int region, array<Byte>^ data, int width, int height, X264PixelFormat format)
+	{
+		if (data == nullptr)
+			throw gcnew ArgumentNullException("data");
+		int bytesPerPixel = X264Options::BytesPerPixel(format);
+		if (width < 1 || height < 1)
+			throw gcnew ArgumentException("Input dimensions must be positive. Provided dimensions: " + width + " x " + height);
+		if (data->Length < (int64_t)width * height * bytesPerPixel)
+			throw gcnew ArgumentException("Input image data has size " + data->Length + " but the expected size is " + ((int64_t)width * height * bytesPerPixel) + " (" + width + " * " + height + " * " + bytesPerPixel + ")", "data");
+		pin_ptr<Byte> pinned_data = &data[0];
+		Render(region, pinned_data, width * bytesPerPixel, width, height, format);
+	}
+	void MosaicEncoder::SetInput(int region, IntPtr data, int stride, int width, int height, X264PixelFormat format)
+	{
+		if (data == IntPtr::Zero)
+			throw gcnew ArgumentNullException("data");
+		if (width < 1 || height < 1)
+			throw gcnew ArgumentException("Input dimensions must be positive. Provided dimensions: " + width + " x " + height);
+		int rowBytes = width * X264Options::BytesPerPixel(format);
+		if (Math::Abs(stride) < rowBytes)
+			throw gcnew ArgumentException("The stride must be at least width * bytes per pixel (" + rowBytes + ") in either direction. Provided value: " + stride, "stride");
+		Render(region, (const uint8_t*)data.ToPointer(), stride, width, height, format);
+	}
+	void MosaicEncoder::Render(int region, const uint8_t* data, int stride, int width, int height, X264PixelFormat format)
+	{
+		MosaicRegion* target = GetRegion(region);
+		ScaleToI420Function scale = GetScaleToI420((YuvMatrix)(int)Options->ColorMatrix, Options->FullRange, (PixelLayout)(int)format);
+		x264_picture_t* picture = encoder->InputPicture;
+		target->Render(scale, data, stride, width, height, picture->img.plane, picture->img.i_stride);
+	}
+	void MosaicEncoder::ClearRegion(int region)
+	{
+		MosaicRegion* target = GetRegion(region);
+		x264_picture_t* picture = encoder->InputPicture;
+		target->Clear(Options->FullRange, picture->img.plane, picture->img.i_stride);
+	}
+	array<Byte>^ MosaicEncoder::EncodeFrame()
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("MosaicEncoder");
+		return (array<Byte>^)encoder->EncodeInputPicture(encoder->NextTimestamp, 0, EncodeOutput::WholeArray);
+	}
+	array<Byte>^ MosaicEncoder::EncodeFrame(Int64 timestamp)
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("MosaicEncoder");
+		return (array<Byte>^)encoder->EncodeInputPicture(timestamp, 0, EncodeOutput::WholeArray);
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "X264Options.h"
+#include "MosaicScaler.h"
+
+using namespace System;
+
+namespace x264net {
+
+	ref class X264Net;
+
+	/// <summary>
+	/// <para>Composes several video sources (e.g. camera feeds for a multiview monitor) into one encoded stream, without building an RGB canvas.</para>
+	/// <para>Each input is scaled and converted straight into its region of the encoder's YUV input picture when SetInput is called, so a source that has no new frame costs nothing.  EncodeFrame then encodes the picture as it stands.  Regions that have never received input are black.</para>
+	/// <para>This instance must be disposed when you are finished with it.</para>
+	/// </summary>
+	public ref class MosaicEncoder
+	{
+	private:
+		X264Net^ encoder;
+		System::Collections::Generic::List<IntPtr>^ regions;
+		bool isDisposed;
+		!MosaicEncoder();
+		MosaicRegion* GetRegion(int region);
+		void Render(int region, const uint8_t* data, int stride, int width, int height, X264PixelFormat format);
+	public:
+		/// <summary>
+		/// <para>The options of the output stream.  Width and Height are the size of the whole mosaic.</para>
+		/// </summary>
+		X264Options^ Options;
+
+		/// <summary>
+		/// <para>Create a MosaicEncoder with no regions.  Add regions with AddRegion or AddGrid.</para>
+		/// </summary>
+		/// <param name="options">The encoding options.  Width and Height are the size of the whole mosaic.</param>
+		MosaicEncoder(X264Options^ options);
+		~MosaicEncoder();
+		/// <summary>
+		/// <para>The encoder that produces the mosaic stream, for access to Flush, JoinSnapshot, FrameBroadcaster, and so on.  Use EncodeFrame on this MosaicEncoder rather than on the encoder itself.</para>
+		/// </summary>
+		property X264Net^ Encoder { X264Net^ get() { return encoder; } }
+		/// <summary>
+		/// <para>The number of regions that have been added.</para>
+		/// </summary>
+		property int RegionCount { int get() { return regions->Count; } }
+		/// <summary>
+		/// <para>Adds a rectangle of the mosaic that an input is drawn into, returning its region number.  Position and size must be even and lie inside the mosaic.  Regions should not overlap.</para>
+		/// </summary>
+		int AddRegion(int x, int y, int width, int height);
+		/// <summary>
+		/// <para>Divides the whole mosaic into columns x rows equal regions, numbered left to right, then top to bottom, after any regions added before.  Returns the number of the first one.</para>
+		/// </summary>
+		int AddGrid(int columns, int rows);
+		/// <summary>
+		/// <para>Draws a new frame from one input into its region, scaling it to fit.  Call this only when the input has a new frame; the region keeps showing the last frame drawn.</para>
+		/// <para>SetInput may be called for different regions from different threads at the same time, but not while EncodeFrame is running.</para>
+		/// </summary>
+		/// <param name="region">The region number.</param>
+		/// <param name="data">The input frame.  Rows are width * bytes per pixel long, without padding.</param>
+		/// <param name="width">The width of the input frame, in pixels.</param>
+		/// <param name="height">The height of the input frame, in pixels.</param>
+		/// <param name="format">The byte layout of the input frame.</param>
+		void SetInput(int region, array<Byte>^ data, int width, int height, X264PixelFormat format);
+		/// <summary>
+		/// <para>Draws a new frame from one input into its region, scaling it to fit, reading it from native memory (e.g. a capture driver's buffer or a locked Bitmap).  See the other overload.</para>
+		/// </summary>
+		/// <param name="region">The region number.</param>
+		/// <param name="data">A pointer to the first row of the input frame.</param>
+		/// <param name="stride">The distance in bytes from the start of one row to the start of the next.</param>
+		/// <param name="width">The width of the input frame, in pixels.</param>
+		/// <param name="height">The height of the input frame, in pixels.</param>
+		/// <param name="format">The byte layout of the input frame.</param>
+		void SetInput(int region, IntPtr data, int stride, int width, int height, X264PixelFormat format);
+		/// <summary>
+		/// <para>Fills a region with black, e.g. when its source disconnects.</para>
+		/// </summary>
+		void ClearRegion(int region);
+		/// <summary>
+		/// <para>Encodes the mosaic as it currently stands, returning a single byte array containing one or more H.264 NAL units.</para>
+		/// </summary>
+		array<Byte>^ EncodeFrame();
+		/// <summary>
+		/// <para>Encodes the mosaic as it currently stands, with the specified timestamp, returning a single byte array containing one or more H.264 NAL units.</para>
+		/// </summary>
+		/// <param name="timestamp">The presentation time of the frame, in units of the timebase (see X264Options.TimebaseNumerator).</param>
+		array<Byte>^ EncodeFrame(Int64 timestamp);
+	};
+}
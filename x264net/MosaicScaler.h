@@ -0,0 +1,195 @@
+#pragma once
+#include "stdint.h"
+#include "RGB_To_YUV420.h"
+#pragma managed( push, off )
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#pragma managed( pop )
+
+#pragma managed( push, off )
+namespace x264net
+{
+	/// <summary>
+	/// <para>Averages the source pixels in columns [x0, x1) of rows [y0, y1).</para>
+	/// </summary>
+	template <typename Layout>
+	inline void AverageFootprint(const uint8_t* src, int srcStride, int x0, int x1, int y0, int y1, int& r, int& g, int& b)
+	{
+		int count = (x1 - x0) * (y1 - y0);
+		int sumR = 0, sumG = 0, sumB = 0;
+		for (int y = y0; y < y1; y++)
+		{
+			const uint8_t* p = src + (ptrdiff_t)y * srcStride + x0 * Layout::Bytes;
+			for (int x = x0; x < x1; x++)
+			{
+				sumR += p[Layout::R];
+				sumG += p[Layout::G];
+				sumB += p[Layout::B];
+				p += Layout::Bytes;
+			}
+		}
+		if (count == 1)
+		{
+			r = sumR;
+			g = sumG;
+			b = sumB;
+		}
+		else
+		{
+			r = (sumR + count / 2) / count;
+			g = (sumG + count / 2) / count;
+			b = (sumB + count / 2) / count;
+		}
+	}
+
+	/// <summary>
+	/// <para>Scales a packed RGB image to width x height pixels and converts it to YUV 4:2:0 in one pass, writing into a region of a larger picture (the destination pointers are the region's top-left corner).  Width and height must be even.</para>
+	/// <para>Each destination pixel is the average of the source pixels it covers (xStart/xEnd and yStart/yEnd give that footprint), which is a box filter when shrinking and nearest neighbour when enlarging.  Chroma is the average of each 2x2 block.</para>
+	/// </summary>
+	template <typename Coefficients, typename Layout>
+	void ScaleToI420(const uint8_t* src, int srcStride, const int* xStart, const int* xEnd, const int* yStart, const int* yEnd, int width, int height, uint8_t* dstY, int strideY, uint8_t* dstU, int strideU, uint8_t* dstV, int strideV)
+	{
+		for (int row = 0; row < height; row += 2)
+		{
+			uint8_t* y0 = dstY + (ptrdiff_t)row * strideY;
+			uint8_t* y1 = y0 + strideY;
+			uint8_t* u = dstU + (ptrdiff_t)(row / 2) * strideU;
+			uint8_t* v = dstV + (ptrdiff_t)(row / 2) * strideV;
+			for (int column = 0; column < width; column += 2)
+			{
+				int sumR = 0, sumG = 0, sumB = 0;
+				for (int dy = 0; dy < 2; dy++)
+				{
+					uint8_t* y = dy ? y1 : y0;
+					for (int dx = 0; dx < 2; dx++)
+					{
+						int r, g, b;
+						AverageFootprint<Layout>(src, srcStride, xStart[column + dx], xEnd[column + dx], yStart[row + dy], yEnd[row + dy], r, g, b);
+						y[column + dx] = Coefficients::Y(r, g, b);
+						sumR += r;
+						sumG += g;
+						sumB += b;
+					}
+				}
+				int r = (sumR + 2) >> 2;
+				int g = (sumG + 2) >> 2;
+				int b = (sumB + 2) >> 2;
+				u[column / 2] = Coefficients::U(r, g, b);
+				v[column / 2] = Coefficients::V(r, g, b);
+			}
+		}
+	}
+
+	typedef void(*ScaleToI420Function)(const uint8_t* src, int srcStride, const int* xStart, const int* xEnd, const int* yStart, const int* yEnd, int width, int height, uint8_t* dstY, int strideY, uint8_t* dstU, int strideU, uint8_t* dstV, int strideV);
+
+	template <typename Coefficients>
+	inline ScaleToI420Function GetScaleToI420(PixelLayout layout)
+	{
+		switch (layout)
+		{
+		case PixelLayoutBgr24:
+			return &ScaleToI420<Coefficients, Bgr24Layout>;
+		case PixelLayoutBgra32:
+			return &ScaleToI420<Coefficients, Bgra32Layout>;
+		case PixelLayoutGray8:
+			return &ScaleToI420<Coefficients, Gray8Layout>;
+		default:
+			return &ScaleToI420<Coefficients, Rgb24Layout>;
+		}
+	}
+
+	/// <summary>
+	/// <para>Selects the scaling kernel specialized for the given matrix, range, and source layout.</para>
+	/// </summary>
+	inline ScaleToI420Function GetScaleToI420(YuvMatrix matrix, bool fullRange, PixelLayout layout)
+	{
+		switch (matrix)
+		{
+		case YuvMatrixBt709:
+			return fullRange ? GetScaleToI420<YuvCoefficients<Bt709, true> >(layout) : GetScaleToI420<YuvCoefficients<Bt709, false> >(layout);
+		case YuvMatrixBt2020:
+			return fullRange ? GetScaleToI420<YuvCoefficients<Bt2020, true> >(layout) : GetScaleToI420<YuvCoefficients<Bt2020, false> >(layout);
+		default:
+			return fullRange ? GetScaleToI420<YuvCoefficients<Bt601, true> >(layout) : GetScaleToI420<YuvCoefficients<Bt601, false> >(layout);
+		}
+	}
+
+	/// <summary>
+	/// <para>Fills a region of a YUV 4:2:0 picture with a flat gray level (black is 16 in limited range, 0 in full range) and neutral chroma.</para>
+	/// </summary>
+	inline void FillI420(int width, int height, uint8_t luma, uint8_t* dstY, int strideY, uint8_t* dstU, int strideU, uint8_t* dstV, int strideV)
+	{
+		for (int row = 0; row < height; row++)
+			memset(dstY + (ptrdiff_t)row * strideY, luma, width);
+		for (int row = 0; row < height / 2; row++)
+		{
+			memset(dstU + (ptrdiff_t)row * strideU, 128, width / 2);
+			memset(dstV + (ptrdiff_t)row * strideV, 128, width / 2);
+		}
+	}
+
+	/// <summary>
+	/// <para>One rectangle of a mosaic, with the source footprint of each destination row and column cached for the most recent source size.</para>
+	/// </summary>
+	class MosaicRegion
+	{
+	public:
+		MosaicRegion(int x, int y, int width, int height) : x(x), y(y), width(width), height(height), sourceWidth(0), sourceHeight(0)
+		{
+		}
+		/// <summary>
+		/// <para>Scales and converts a source image into this region of the picture.</para>
+		/// </summary>
+		void Render(ScaleToI420Function scale, const uint8_t* src, int srcStride, int srcWidth, int srcHeight, uint8_t* const plane[3], const int stride[3])
+		{
+			if (srcWidth != sourceWidth || srcHeight != sourceHeight)
+			{
+				Footprints(srcWidth, width, xStart, xEnd);
+				Footprints(srcHeight, height, yStart, yEnd);
+				sourceWidth = srcWidth;
+				sourceHeight = srcHeight;
+			}
+			scale(src, srcStride, &xStart[0], &xEnd[0], &yStart[0], &yEnd[0], width, height,
+				plane[0] + (ptrdiff_t)y * stride[0] + x, stride[0],
+				plane[1] + (ptrdiff_t)(y / 2) * stride[1] + x / 2, stride[1],
+				plane[2] + (ptrdiff_t)(y / 2) * stride[2] + x / 2, stride[2]);
+		}
+		/// <summary>
+		/// <para>Fills this region of the picture with black.</para>
+		/// </summary>
+		void Clear(bool fullRange, uint8_t* const plane[3], const int stride[3])
+		{
+			FillI420(width, height, fullRange ? 0 : 16,
+				plane[0] + (ptrdiff_t)y * stride[0] + x, stride[0],
+				plane[1] + (ptrdiff_t)(y / 2) * stride[1] + x / 2, stride[1],
+				plane[2] + (ptrdiff_t)(y / 2) * stride[2] + x / 2, stride[2]);
+		}
+		const int x;
+		const int y;
+		const int width;
+		const int height;
+	private:
+		static void Footprints(int sourceLength, int length, std::vector<int>& start, std::vector<int>& end)
+		{
+			start.resize(length);
+			end.resize(length);
+			for (int i = 0; i < length; i++)
+			{
+				start[i] = (int)((int64_t)i * sourceLength / length);
+				end[i] = (int)((int64_t)(i + 1) * sourceLength / length);
+				if (end[i] <= start[i])
+					end[i] = start[i] + 1;
+			}
+		}
+		int sourceWidth;
+		int sourceHeight;
+		std::vector<int> xStart;
+		std::vector<int> xEnd;
+		std::vector<int> yStart;
+		std::vector<int> yEnd;
+		MosaicRegion(const MosaicRegion&);
+		MosaicRegion& operator=(const MosaicRegion&);
+	};
+}
+#pragma managed( pop )
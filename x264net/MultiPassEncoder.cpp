@@ -0,0 +1,72 @@
+#include "MultiPassEncoder.h"
+#include "x264net.h"
+namespace x264net
+{
+	MultiPassEncoder::MultiPassEncoder(X264Options^ options) : Options(options)
+	{
+		Passes = 2;
+	}
+	void MultiPassEncoder::EncodeToSize(Func<int, array<Byte>^>^ getFrame, int frameCount, Int64 targetSizeBytes, System::IO::Stream^ output)
+	{
+		if (targetSizeBytes <= 0)
+			throw gcnew ArgumentOutOfRangeException("targetSizeBytes", "targetSizeBytes must be greater than 0");
+		if (frameCount < 1)
+			throw gcnew ArgumentOutOfRangeException("frameCount", "frameCount must be greater than 0");
+		if (Options->FPS < 1 || Options->FPSDenominator < 1)
+			throw gcnew Exception("FPS and FPSDenominator must be at least 1 to calculate a bit rate from a target size. Provided values: " + Options->FPS + " / " + Options->FPSDenominator);
+		double seconds = frameCount * (double)Options->FPSDenominator / Options->FPS;
+		double kbps = (targetSizeBytes * 8.0 / 1000.0) / seconds;
+		EncodeToBitRate(getFrame, frameCount, (int)Math::Max(1.0, Math::Floor(kbps)), output);
+	}
+	void MultiPassEncoder::EncodeToBitRate(Func<int, array<Byte>^>^ getFrame, int frameCount, int averageBitRate, System::IO::Stream^ output)
+	{
+		if (Passes < 2)
+			throw gcnew Exception("Passes must be at least 2. Provided value: " + Passes);
+		if (averageBitRate <= 0)
+			throw gcnew ArgumentOutOfRangeException("averageBitRate", "averageBitRate must be greater than 0");
+
+		String^ statsFile = System::IO::Path::GetTempFileName();
+		try
+		{
+			X264Options^ passOptions = Options->Clone();
+			passOptions->StatsFile = statsFile;
+			passOptions->AverageBitRate = averageBitRate;
+			for (int pass = 1; pass <= Passes; pass++)
+			{
+				// Only the last pass produces output worth keeping.
+				passOptions->Pass = pass == 1 ? 1 : (pass == Passes ? 2 : 3);
+				RunPass(passOptions, getFrame, frameCount, pass == Passes ? output : System::IO::Stream::Null);
+			}
+		}
+		finally
+		{
+			try
+			{
+				System::IO::File::Delete(statsFile);
+				System::IO::File::Delete(statsFile + ".mbtree");
+			}
+			catch (Exception^)
+			{
+			}
+		}
+	}
+	void MultiPassEncoder::RunPass(X264Options^ passOptions, Func<int, array<Byte>^>^ getFrame, int frameCount, System::IO::Stream^ output)
+	{
+		X264Net^ encoder = gcnew X264Net(passOptions);
+		try
+		{
+			for (int i = 0; i < frameCount; i++)
+			{
+				array<Byte>^ data = encoder->EncodeFrameAsWholeArray(getFrame(i));
+				output->Write(data, 0, data->Length);
+			}
+			array<Byte>^ data = encoder->Flush();
+			output->Write(data, 0, data->Length);
+		}
+		finally
+		{
+			// The stats file is only complete once the encoder is closed.
+			delete encoder;
+		}
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "X264Options.h"
+
+using namespace System;
+
+namespace x264net {
+
+	/// <summary>
+	/// <para>Encodes a recording offline in two or more passes, so that the output lands on a target size (or average bit rate) while spending bits where the content needs them.</para>
+	/// <para>The first pass runs with x264's fast first-pass settings and only gathers statistics; its output is discarded.  The statistics are kept in a temporary file which is deleted afterward.</para>
+	/// </summary>
+	public ref class MultiPassEncoder
+	{
+	public:
+		/// <summary>
+		/// <para>The options to encode with.  Pass, StatsFile, and AverageBitRate are managed by this class and are ignored.</para>
+		/// </summary>
+		X264Options^ Options;
+		/// <summary>
+		/// <para>The total number of passes, including the first.  Default: 2.  A third pass rarely helps by more than a fraction of a percent.</para>
+		/// </summary>
+		int Passes;
+
+		/// <summary>
+		/// <para>Create a MultiPassEncoder.</para>
+		/// </summary>
+		/// <param name="options">The encoding options to use.</param>
+		MultiPassEncoder(X264Options^ options);
+
+		/// <summary>
+		/// <para>Encodes frameCount frames, aiming for an output of targetSizeBytes bytes, and writes the H.264 Annex-B stream to output.  The bit rate is derived from the frame count and the FPS option.</para>
+		/// <para>getFrame is called with a frame index and must return that frame's image data in Options.InputFormat, laid out as for X264Net.EncodeFrameAsWholeArray (Height rows of InputStride bytes, or tightly packed).  Every frame is requested once per pass, in order.</para>
+		/// </summary>
+		void EncodeToSize(Func<int, array<Byte>^>^ getFrame, int frameCount, Int64 targetSizeBytes, System::IO::Stream^ output);
+		/// <summary>
+		/// <para>Encodes frameCount frames at the given average bit rate (in kbps), and writes the H.264 Annex-B stream to output.</para>
+		/// <para>getFrame is called with a frame index and must return that frame's image data in Options.InputFormat, laid out as for X264Net.EncodeFrameAsWholeArray (Height rows of InputStride bytes, or tightly packed).  Every frame is requested once per pass, in order.</para>
+		/// </summary>
+		void EncodeToBitRate(Func<int, array<Byte>^>^ getFrame, int frameCount, int averageBitRate, System::IO::Stream^ output);
+	private:
+		void RunPass(X264Options^ passOptions, Func<int, array<Byte>^>^ getFrame, int frameCount, System::IO::Stream^ output);
+	};
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include "stdint.h"
+#include "RGB_To_YUV420.h"
+#pragma managed( push, off )
+#include <cstddef>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#pragma managed( pop )
+
+#pragma managed( push, off )
+namespace x264net
+{
+	/// <summary>
+	/// <para>Blends a flat value into a rectangle of one plane through a per-pixel alpha mask (0 = keep the plane, 255 = replace it): dst = (dst * (256 - a) + value * a + 128) >> 8, with a scaled to 0..256.  Processes 16 pixels per step with SSE2.</para>
+	/// <para>Samples at even offsets take the value even and those at odd offsets the value odd, so one call covers the interleaved U and V of an NV12 chroma plane.  For an ordinary plane, pass the same value twice.</para>
+	/// </summary>
+	inline void BlendPlane(uint8_t* dst, int dstStride, const uint8_t* alpha, int alphaStride, int width, int height, uint8_t even, uint8_t odd)
+	{
+		for (int row = 0; row < height; row++)
+		{
+			uint8_t* d = dst + (ptrdiff_t)row * dstStride;
+			const uint8_t* a = alpha + (ptrdiff_t)row * alphaStride;
+			int x = 0;
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i full = _mm_set1_epi16(256);
+			const __m128i rounding = _mm_set1_epi16(128);
+			const __m128i fill = _mm_set1_epi32((int)((uint32_t)even | ((uint32_t)odd << 16)));
+			for (; x + 16 <= width; x += 16)
+			{
+				__m128i mask = _mm_loadu_si128((const __m128i*)(a + x));
+				// Most of a text box is fully transparent or fully opaque.
+				int coverage = _mm_movemask_epi8(_mm_cmpeq_epi8(mask, zero));
+				if (coverage == 0xFFFF)
+					continue;
+				__m128i pixels = _mm_loadu_si128((const __m128i*)(d + x));
+				__m128i alphaLow = _mm_unpacklo_epi8(mask, zero);
+				__m128i alphaHigh = _mm_unpackhi_epi8(mask, zero);
+				alphaLow = _mm_add_epi16(alphaLow, _mm_srli_epi16(alphaLow, 7));
+				alphaHigh = _mm_add_epi16(alphaHigh, _mm_srli_epi16(alphaHigh, 7));
+				__m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), _mm_sub_epi16(full, alphaLow)), _mm_mullo_epi16(fill, alphaLow));
+				__m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), _mm_sub_epi16(full, alphaHigh)), _mm_mullo_epi16(fill, alphaHigh));
+				low = _mm_srli_epi16(_mm_add_epi16(low, rounding), 8);
+				high = _mm_srli_epi16(_mm_add_epi16(high, rounding), 8);
+				_mm_storeu_si128((__m128i*)(d + x), _mm_packus_epi16(low, high));
+			}
+#endif
+			for (; x < width; x++)
+			{
+				int weight = a[x] + (a[x] >> 7);
+				int value = (x & 1) ? odd : even;
+				d[x] = (uint8_t)((d[x] * (256 - weight) + value * weight + 128) >> 8);
+			}
+		}
+	}
+	inline void BlendPlane(uint8_t* dst, int dstStride, const uint8_t* alpha, int alphaStride, int width, int height, uint8_t value)
+	{
+		BlendPlane(dst, dstStride, alpha, alphaStride, width, height, value, value);
+	}
+
+	/// <summary>
+	/// <para>Blends a flat value into a rectangle of one plane with the same opacity everywhere (0..255).  Even and odd samples take the values even and odd, as with BlendPlane.  Processes 16 pixels per step with SSE2.</para>
+	/// </summary>
+	inline void BlendPlaneConstant(uint8_t* dst, int dstStride, int width, int height, uint8_t even, uint8_t odd, uint8_t opacity)
+	{
+		if (opacity == 0)
+			return;
+		int weight = opacity + (opacity >> 7);
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i keep = _mm_set1_epi16((short)(256 - weight));
+		// The value's share and the rounding term are the same for every pixel.  At most 255 * 256 + 128, so the sums fit in unsigned 16 bits.
+		const __m128i add = _mm_set1_epi32((int)((uint32_t)(even * weight + 128) | ((uint32_t)(odd * weight + 128) << 16)));
+#endif
+		for (int row = 0; row < height; row++)
+		{
+			uint8_t* d = dst + (ptrdiff_t)row * dstStride;
+			int x = 0;
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+			for (; x + 16 <= width; x += 16)
+			{
+				__m128i pixels = _mm_loadu_si128((const __m128i*)(d + x));
+				__m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), keep), add);
+				__m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), keep), add);
+				_mm_storeu_si128((__m128i*)(d + x), _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8)));
+			}
+#endif
+			for (; x < width; x++)
+				d[x] = (uint8_t)((d[x] * (256 - weight) + ((x & 1) ? odd : even) * weight + 128) >> 8);
+		}
+	}
+	inline void BlendPlaneConstant(uint8_t* dst, int dstStride, int width, int height, uint8_t value, uint8_t opacity)
+	{
+		BlendPlaneConstant(dst, dstStride, width, height, value, value, opacity);
+	}
+
+	/// <summary>
+	/// <para>Downsamples a luma-resolution alpha mask to chroma resolution by averaging each 2x2 block.  Width and height must be even.  If interleaved, each chroma alpha is written twice, for the U and V of an NV12 plane, so chromaAlpha rows are width bytes instead of width / 2.</para>
+	/// </summary>
+	inline void DownsampleAlpha(const uint8_t* alpha, int width, int height, uint8_t* chromaAlpha, bool interleaved)
+	{
+		for (int row = 0; row < height / 2; row++)
+		{
+			const uint8_t* top = alpha + (ptrdiff_t)row * 2 * width;
+			const uint8_t* bottom = top + width;
+			uint8_t* out = chromaAlpha + (ptrdiff_t)row * (interleaved ? width : width / 2);
+			for (int x = 0; x < width / 2; x++)
+			{
+				uint8_t average = (uint8_t)((top[2 * x] + top[2 * x + 1] + bottom[2 * x] + bottom[2 * x + 1] + 2) >> 2);
+				if (interleaved)
+					out[2 * x] = out[2 * x + 1] = average;
+				else
+					out[x] = average;
+			}
+		}
+	}
+
+	/// <summary>
+	/// <para>Converts one RGB color to YUV with the given matrix and range.</para>
+	/// </summary>
+	inline void RgbToYuvPixel(YuvMatrix matrix, bool fullRange, int r, int g, int b, uint8_t& y, uint8_t& u, uint8_t& v)
+	{
+		switch (matrix)
+		{
+		case YuvMatrixBt709:
+			if (fullRange) { typedef YuvCoefficients<Bt709, true> C; y = C::Y(r, g, b); u = C::U(r, g, b); v = C::V(r, g, b); }
+			else { typedef YuvCoefficients<Bt709, false> C; y = C::Y(r, g, b); u = C::U(r, g, b); v = C::V(r, g, b); }
+			break;
+		case YuvMatrixBt2020:
+			if (fullRange) { typedef YuvCoefficients<Bt2020, true> C; y = C::Y(r, g, b); u = C::U(r, g, b); v = C::V(r, g, b); }
+			else { typedef YuvCoefficients<Bt2020, false> C; y = C::Y(r, g, b); u = C::U(r, g, b); v = C::V(r, g, b); }
+			break;
+		default:
+			if (fullRange) { typedef YuvCoefficients<Bt601, true> C; y = C::Y(r, g, b); u = C::U(r, g, b); v = C::V(r, g, b); }
+			else { typedef YuvCoefficients<Bt601, false> C; y = C::Y(r, g, b); u = C::U(r, g, b); v = C::V(r, g, b); }
+			break;
+		}
+	}
+}
+#pragma managed( pop )
\ No newline at end of file
@@ -0,0 +1,376 @@
+#include "OsdOverlay.h"
+namespace x264net
+{
+	using namespace System::Drawing;
+	using namespace System::Collections::Generic;
+
+	/// <summary>
+	/// <para>One rasterized character: its advance width and a coverage mask of width x the atlas cell height.</para>
+	/// </summary>
+	ref class OsdGlyph
+	{
+	public:
+		int width;
+		array<Byte>^ alpha;
+	};
+
+	/// <summary>
+	/// <para>The glyphs of one font, rasterized on first use and kept for the life of the process.  Shared by every overlay using the same font.</para>
+	/// </summary>
+	ref class OsdGlyphAtlas
+	{
+	private:
+		static Dictionary<String^, OsdGlyphAtlas^>^ atlases = gcnew Dictionary<String^, OsdGlyphAtlas^>();
+		Font^ font;
+		StringFormat^ format;
+		Dictionary<Char, OsdGlyph^>^ glyphs;
+		OsdGlyphAtlas(String^ family, float size)
+		{
+			font = gcnew Font(family, size, FontStyle::Regular, GraphicsUnit::Pixel);
+			format = (StringFormat^)StringFormat::GenericTypographic->Clone();
+			format->FormatFlags = format->FormatFlags | StringFormatFlags::MeasureTrailingSpaces;
+			CellHeight = (int)Math::Ceiling(font->GetHeight());
+			glyphs = gcnew Dictionary<Char, OsdGlyph^>();
+		}
+		OsdGlyph^ Rasterize(Char c)
+		{
+			OsdGlyph^ glyph = gcnew OsdGlyph();
+			String^ s = gcnew String(c, 1);
+			Bitmap^ bitmap = gcnew Bitmap(1, 1, System::Drawing::Imaging::PixelFormat::Format32bppRgb);
+			try
+			{
+				Graphics^ g = Graphics::FromImage(bitmap);
+				try
+				{
+					glyph->width = Math::Max(1, (int)Math::Ceiling(g->MeasureString(s, font, PointF(0, 0), format).Width));
+				}
+				finally
+				{
+					delete g;
+				}
+			}
+			finally
+			{
+				delete bitmap;
+			}
+			glyph->alpha = gcnew array<Byte>(glyph->width * CellHeight);
+			if (Char::IsWhiteSpace(c))
+				return glyph;
+
+			// Draw white on black; any channel of the result is the coverage.
+			bitmap = gcnew Bitmap(glyph->width, CellHeight, System::Drawing::Imaging::PixelFormat::Format32bppRgb);
+			try
+			{
+				Graphics^ g = Graphics::FromImage(bitmap);
+				try
+				{
+					g->Clear(Color::Black);
+					g->TextRenderingHint = System::Drawing::Text::TextRenderingHint::AntiAliasGridFit;
+					g->DrawString(s, font, Brushes::White, PointF(0, 0), format);
+				}
+				finally
+				{
+					delete g;
+				}
+				System::Drawing::Imaging::BitmapData^ locked = bitmap->LockBits(Rectangle(0, 0, glyph->width, CellHeight), System::Drawing::Imaging::ImageLockMode::ReadOnly, System::Drawing::Imaging::PixelFormat::Format32bppRgb);
+				try
+				{
+					for (int row = 0; row < CellHeight; row++)
+					{
+						const uint8_t* pixels = (const uint8_t*)locked->Scan0.ToPointer() + (ptrdiff_t)row * locked->Stride;
+						for (int column = 0; column < glyph->width; column++)
+							glyph->alpha[row * glyph->width + column] = pixels[column * 4 + 1];
+					}
+				}
+				finally
+				{
+					bitmap->UnlockBits(locked);
+				}
+			}
+			finally
+			{
+				delete bitmap;
+			}
+			return glyph;
+		}
+	public:
+		int CellHeight;
+
+		static OsdGlyphAtlas^ Get(String^ family, float size)
+		{
+			String^ key = family + "|" + size.ToString(System::Globalization::CultureInfo::InvariantCulture);
+			System::Threading::Monitor::Enter(atlases);
+			try
+			{
+				OsdGlyphAtlas^ atlas;
+				if (!atlases->TryGetValue(key, atlas))
+				{
+					atlas = gcnew OsdGlyphAtlas(family, size);
+					atlases[key] = atlas;
+				}
+				return atlas;
+			}
+			finally
+			{
+				System::Threading::Monitor::Exit(atlases);
+			}
+		}
+		OsdGlyph^ GetGlyph(Char c)
+		{
+			System::Threading::Monitor::Enter(glyphs);
+			try
+			{
+				OsdGlyph^ glyph;
+				if (!glyphs->TryGetValue(c, glyph))
+				{
+					glyph = Rasterize(c);
+					glyphs[c] = glyph;
+				}
+				return glyph;
+			}
+			finally
+			{
+				System::Threading::Monitor::Exit(glyphs);
+			}
+		}
+	};
+
+	OsdOverlay::OsdOverlay()
+	{
+		Initialize("", 0, 0);
+	}
+	OsdOverlay::OsdOverlay(String^ text, int x, int y)
+	{
+		Initialize(text, x, y);
+	}
+	void OsdOverlay::Initialize(String^ text, int x, int y)
+	{
+		sync = gcnew Object();
+		this->text = text;
+		this->x = x;
+		this->y = y;
+		fontFamily = "Consolas";
+		fontSize = 16;
+		padding = 2;
+		foregroundColor = Color::White;
+		backgroundColor = Color::FromArgb(128, 0, 0, 0);
+		layoutGeneration = 0;
+		laidOutGeneration = -1;
+		Changed(true);
+	}
+	void OsdOverlay::Text::set(String^ value)
+	{
+		System::Threading::Monitor::Enter(sync);
+		try
+		{
+			text = value;
+			Changed(true);
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(sync);
+		}
+	}
+	void OsdOverlay::FontFamily::set(String^ value)
+	{
+		System::Threading::Monitor::Enter(sync);
+		try
+		{
+			fontFamily = value;
+			Changed(true);
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(sync);
+		}
+	}
+	void OsdOverlay::FontSize::set(float value)
+	{
+		System::Threading::Monitor::Enter(sync);
+		try
+		{
+			fontSize = value;
+			Changed(true);
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(sync);
+		}
+	}
+	void OsdOverlay::X::set(int value)
+	{
+		System::Threading::Monitor::Enter(sync);
+		try
+		{
+			x = value;
+			Changed(false);
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(sync);
+		}
+	}
+	void OsdOverlay::Y::set(int value)
+	{
+		System::Threading::Monitor::Enter(sync);
+		try
+		{
+			y = value;
+			Changed(false);
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(sync);
+		}
+	}
+	void OsdOverlay::Padding::set(int value)
+	{
+		System::Threading::Monitor::Enter(sync);
+		try
+		{
+			padding = value;
+			Changed(true);
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(sync);
+		}
+	}
+	void OsdOverlay::ForegroundColor::set(Color value)
+	{
+		System::Threading::Monitor::Enter(sync);
+		try
+		{
+			foregroundColor = value;
+			Changed(true);
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(sync);
+		}
+	}
+	void OsdOverlay::BackgroundColor::set(Color value)
+	{
+		System::Threading::Monitor::Enter(sync);
+		try
+		{
+			backgroundColor = value;
+			Changed(false);
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(sync);
+		}
+	}
+	/// <summary>
+	/// <para>Composes the text into a luma coverage mask from the cached glyphs, and averages it down to a chroma mask.  The foreground opacity is folded into the masks.</para>
+	/// </summary>
+	void OsdOverlay::Layout()
+	{
+		if (fontSize <= 0)
+			throw gcnew ArgumentException("OsdOverlay.FontSize must be positive. Provided value: " + fontSize);
+		atlas = OsdGlyphAtlas::Get(fontFamily, fontSize);
+		String^ line = text == nullptr ? "" : text;
+		int pad = Math::Max(0, padding);
+		int textWidth = 0;
+		array<OsdGlyph^>^ glyphs = gcnew array<OsdGlyph^>(line->Length);
+		for (int i = 0; i < line->Length; i++)
+		{
+			glyphs[i] = atlas->GetGlyph(line[i]);
+			textWidth += glyphs[i]->width;
+		}
+		maskWidth = (textWidth + pad * 2 + 1) & ~1;
+		maskHeight = (atlas->CellHeight + pad * 2 + 1) & ~1;
+		lumaMask = gcnew array<Byte>(maskWidth * maskHeight);
+		chromaMask = gcnew array<Byte>((maskWidth / 2) * (maskHeight / 2));
+		interleavedChromaMask = gcnew array<Byte>(maskWidth * (maskHeight / 2));
+		int opacity = foregroundColor.A;
+		int left = pad;
+		for (int i = 0; i < glyphs->Length; i++)
+		{
+			OsdGlyph^ glyph = glyphs[i];
+			for (int row = 0; row < atlas->CellHeight; row++)
+			{
+				for (int column = 0; column < glyph->width; column++)
+					lumaMask[(pad + row) * maskWidth + left + column] = (Byte)((glyph->alpha[row * glyph->width + column] * opacity + 127) / 255);
+			}
+			left += glyph->width;
+		}
+		if (chromaMask->Length > 0)
+		{
+			pin_ptr<Byte> luma = &lumaMask[0];
+			pin_ptr<Byte> chroma = &chromaMask[0];
+			pin_ptr<Byte> interleavedChroma = &interleavedChromaMask[0];
+			DownsampleAlpha(luma, maskWidth, maskHeight, chroma, false);
+			DownsampleAlpha(luma, maskWidth, maskHeight, interleavedChroma, true);
+		}
+	}
+	/// <summary>
+	/// <para>Draws the overlay into an I420 picture (or an NV12 picture, if interleaved) of width x height pixels, clipped to the picture.</para>
+	/// </summary>
+	void OsdOverlay::Blend(uint8_t* const* plane, const int* stride, int width, int height, YuvMatrix matrix, bool fullRange, bool interleaved)
+	{
+		System::Threading::Monitor::Enter(sync);
+		try
+		{
+			// Read the generation first: a property changed while laying out is picked up on the next frame.
+			int generation = layoutGeneration;
+			if (generation != laidOutGeneration)
+			{
+				Layout();
+				laidOutGeneration = generation;
+			}
+			int left = x & ~1;
+			int top = y & ~1;
+			int clipLeft = Math::Max(left, 0);
+			int clipTop = Math::Max(top, 0);
+			int clipRight = Math::Min(left + maskWidth, width & ~1);
+			int clipBottom = Math::Min(top + maskHeight, height & ~1);
+			if (clipLeft >= clipRight || clipTop >= clipBottom)
+				return;
+			int w = clipRight - clipLeft;
+			int h = clipBottom - clipTop;
+			uint8_t* y0 = plane[0] + (ptrdiff_t)clipTop * stride[0] + clipLeft;
+			uint8_t* u0 = plane[1] + (ptrdiff_t)(clipTop / 2) * stride[1] + (interleaved ? clipLeft : clipLeft / 2);
+			uint8_t* v0 = interleaved ? NULL : plane[2] + (ptrdiff_t)(clipTop / 2) * stride[2] + clipLeft / 2;
+
+			uint8_t yValue, uValue, vValue;
+			if (backgroundColor.A != 0)
+			{
+				RgbToYuvPixel(matrix, fullRange, backgroundColor.R, backgroundColor.G, backgroundColor.B, yValue, uValue, vValue);
+				BlendPlaneConstant(y0, stride[0], w, h, yValue, backgroundColor.A);
+				if (interleaved)
+					BlendPlaneConstant(u0, stride[1], w, h / 2, uValue, vValue, backgroundColor.A);
+				else
+				{
+					BlendPlaneConstant(u0, stride[1], w / 2, h / 2, uValue, backgroundColor.A);
+					BlendPlaneConstant(v0, stride[2], w / 2, h / 2, vValue, backgroundColor.A);
+				}
+			}
+			if (foregroundColor.A != 0)
+			{
+				RgbToYuvPixel(matrix, fullRange, foregroundColor.R, foregroundColor.G, foregroundColor.B, yValue, uValue, vValue);
+				pin_ptr<Byte> luma = &lumaMask[0];
+				const uint8_t* lumaStart = luma + (clipTop - top) * maskWidth + (clipLeft - left);
+				BlendPlane(y0, stride[0], lumaStart, maskWidth, w, h, yValue);
+				if (interleaved)
+				{
+					pin_ptr<Byte> chroma = &interleavedChromaMask[0];
+					const uint8_t* chromaStart = chroma + ((clipTop - top) / 2) * maskWidth + (clipLeft - left);
+					BlendPlane(u0, stride[1], chromaStart, maskWidth, w, h / 2, uValue, vValue);
+				}
+				else
+				{
+					pin_ptr<Byte> chroma = &chromaMask[0];
+					const uint8_t* chromaStart = chroma + ((clipTop - top) / 2) * (maskWidth / 2) + (clipLeft - left) / 2;
+					BlendPlane(u0, stride[1], chromaStart, maskWidth / 2, w / 2, h / 2, uValue);
+					BlendPlane(v0, stride[2], chromaStart, maskWidth / 2, w / 2, h / 2, vValue);
+				}
+			}
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(sync);
+		}
+	}
+}
\ No newline at end of file
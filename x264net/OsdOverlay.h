@@ -0,0 +1,97 @@
+#pragma once
+#include "stdint.h"
+#include "OsdBlend.h"
+
+using namespace System;
+
+namespace x264net {
+
+	ref class OsdGlyphAtlas;
+
+	/// <summary>
+	/// <para>A line of text (e.g. a timestamp or camera label) burned into every frame an X264Net encodes.  Add it to X264Net.Overlays.</para>
+	/// <para>The text is blended straight into the YUV picture after color conversion, touching only its own rectangle.  Glyphs are rasterized once per font and cached, and the text is laid out again only when a property changes, so an unchanged overlay costs just the blend.</para>
+	/// <para>Properties may be changed from any thread; the change applies from the next frame encoded.  Setters wait for a blend in progress, so a frame never mixes old and new properties.</para>
+	/// </summary>
+	public ref class OsdOverlay
+	{
+	private:
+		static int64_t lastVersion;
+		/// <summary>
+		/// <para>Held by the setters and by Blend.  Private, so code that locks the overlay itself cannot stall encoding.</para>
+		/// </summary>
+		Object^ sync;
+		int64_t version;
+		String^ text;
+		String^ fontFamily;
+		float fontSize;
+		int x;
+		int y;
+		int padding;
+		System::Drawing::Color foregroundColor;
+		System::Drawing::Color backgroundColor;
+		OsdGlyphAtlas^ atlas;
+		array<Byte>^ lumaMask;
+		array<Byte>^ chromaMask;
+		array<Byte>^ interleavedChromaMask;
+		int maskWidth;
+		int maskHeight;
+		int layoutGeneration;
+		int laidOutGeneration;
+		void Initialize(String^ text, int x, int y);
+		void Changed(bool layout)
+		{
+			version = System::Threading::Interlocked::Increment(lastVersion);
+			if (layout)
+				System::Threading::Interlocked::Increment(layoutGeneration);
+		}
+		void Layout();
+	internal:
+		/// <summary>
+		/// <para>Changes whenever the overlay's appearance does.  Unique across all overlays, so encoders can tell whether their overlays look the same as in the previous frame.</para>
+		/// </summary>
+		property int64_t Version { int64_t get() { return version; } }
+		void Blend(uint8_t* const* plane, const int* stride, int width, int height, YuvMatrix matrix, bool fullRange, bool interleaved);
+	public:
+		/// <summary>
+		/// <para>Create an overlay with no text at the top left corner, in white 16 pixel Consolas on a half-transparent black box.</para>
+		/// </summary>
+		OsdOverlay();
+		/// <summary>
+		/// <para>Create an overlay with the given text and position, in white 16 pixel Consolas on a half-transparent black box.</para>
+		/// </summary>
+		OsdOverlay(String^ text, int x, int y);
+		/// <summary>
+		/// <para>The text to draw, on a single line.</para>
+		/// </summary>
+		property String^ Text { String^ get() { return text; } void set(String^ value); }
+		/// <summary>
+		/// <para>The name of the font family.  Default: "Consolas".</para>
+		/// </summary>
+		property String^ FontFamily { String^ get() { return fontFamily; } void set(String^ value); }
+		/// <summary>
+		/// <para>The font size, in pixels.  Default: 16.</para>
+		/// </summary>
+		property float FontSize { float get() { return fontSize; } void set(float value); }
+		/// <summary>
+		/// <para>The left edge of the box, in pixels.  Rounded down to an even number, because chroma samples cover 2x2 pixels.</para>
+		/// </summary>
+		property int X { int get() { return x; } void set(int value); }
+		/// <summary>
+		/// <para>The top edge of the box, in pixels.  Rounded down to an even number.</para>
+		/// </summary>
+		property int Y { int get() { return y; } void set(int value); }
+		/// <summary>
+		/// <para>The space between the text and the edges of the box, in pixels.  Default: 2.</para>
+		/// </summary>
+		property int Padding { int get() { return padding; } void set(int value); }
+		/// <summary>
+		/// <para>The color of the text.  Its alpha is the opacity of the text.  Default: White.</para>
+		/// </summary>
+		property System::Drawing::Color ForegroundColor { System::Drawing::Color get() { return foregroundColor; } void set(System::Drawing::Color value); }
+		/// <summary>
+		/// <para>The color of the box behind the text.  Its alpha is the opacity of the box; use Color.Transparent for no box.  Default: black at 50% opacity.</para>
+		/// </summary>
+		property System::Drawing::Color BackgroundColor { System::Drawing::Color get() { return backgroundColor; } void set(System::Drawing::Color value); }
+	};
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+#include "stdint.h"
+#include "lib/x264/include/x264.h"
+#pragma managed( push, off )
+#include <cstddef>
+#include <cstdlib>
+#pragma managed( pop )
+
+#pragma managed( push, off )
+namespace x264net
+{
+	/// <summary>
+	/// <para>Recycles the memory of YUV 4:2:0 input pictures in power-of-two size classes, so that an encoder switching between a few resolutions allocates nothing after the first switch to each size.</para>
+	/// <para>Pictures from the pool must be returned with Release, never passed to x264_picture_clean.  The pool is used by one encoder at a time and is not thread-safe.</para>
+	/// </summary>
+	class PicturePool
+	{
+	public:
+		PicturePool()
+		{
+			for (int i = 0; i < ClassCount; i++)
+				freeLists[i] = NULL;
+		}
+		~PicturePool()
+		{
+			for (int i = 0; i < ClassCount; i++)
+			{
+				while (freeLists[i])
+				{
+					Entry* next = freeLists[i]->nextFree;
+					free(freeLists[i]->memory);
+					delete freeLists[i];
+					freeLists[i] = next;
+				}
+			}
+		}
+		/// <summary>
+		/// <para>Returns a picture laid out for csp (X264_CSP_I420 or X264_CSP_NV12) at width x height, with rows padded to a multiple of 64 bytes.  The pixel contents are undefined.  Returns NULL if memory could not be allocated.</para>
+		/// </summary>
+		x264_picture_t* Acquire(int csp, int width, int height)
+		{
+			int stride = (width + Alignment - 1) / Alignment * Alignment;
+			size_t lumaSize = (size_t)stride * height;
+			size_t size = lumaSize + lumaSize / 2;
+			int sizeClass = SizeClass(size);
+			if (sizeClass < 0)
+				return NULL;
+			Entry* entry = freeLists[sizeClass];
+			if (entry)
+				freeLists[sizeClass] = entry->nextFree;
+			else
+			{
+				entry = new Entry();
+				entry->sizeClass = sizeClass;
+				entry->memory = (uint8_t*)malloc((MinimumCapacity << sizeClass) + Alignment);
+				if (!entry->memory)
+				{
+					delete entry;
+					return NULL;
+				}
+			}
+			entry->nextFree = NULL;
+			uint8_t* base = (uint8_t*)(((uintptr_t)entry->memory + Alignment - 1) & ~(uintptr_t)(Alignment - 1));
+
+			x264_picture_t* picture = &entry->picture;
+			x264_picture_init(picture);
+			picture->img.i_csp = csp;
+			picture->img.plane[0] = base;
+			picture->img.i_stride[0] = stride;
+			if (csp == X264_CSP_NV12)
+			{
+				picture->img.i_plane = 2;
+				picture->img.plane[1] = base + lumaSize;
+				picture->img.i_stride[1] = stride;
+			}
+			else
+			{
+				picture->img.i_plane = 3;
+				picture->img.plane[1] = base + lumaSize;
+				picture->img.i_stride[1] = stride / 2;
+				picture->img.plane[2] = base + lumaSize + lumaSize / 4;
+				picture->img.i_stride[2] = stride / 2;
+			}
+			return picture;
+		}
+		/// <summary>
+		/// <para>Returns a picture obtained from Acquire to the pool.  NULL is ignored.</para>
+		/// </summary>
+		void Release(x264_picture_t* picture)
+		{
+			if (!picture)
+				return;
+			// The picture is the first member of its entry.
+			Entry* entry = (Entry*)picture;
+			entry->nextFree = freeLists[entry->sizeClass];
+			freeLists[entry->sizeClass] = entry;
+		}
+	private:
+		struct Entry
+		{
+			x264_picture_t picture;
+			uint8_t* memory;
+			int sizeClass;
+			Entry* nextFree;
+		};
+		static const int Alignment = 64;
+		static const size_t MinimumCapacity = 64 * 1024;
+		static const int ClassCount = 16;
+		static int SizeClass(size_t size)
+		{
+			for (int sizeClass = 0; sizeClass < ClassCount; sizeClass++)
+			{
+				if ((MinimumCapacity << sizeClass) >= size)
+					return sizeClass;
+			}
+			return -1;
+		}
+		Entry* freeLists[ClassCount];
+		PicturePool(const PicturePool&);
+		PicturePool& operator=(const PicturePool&);
+	};
+}
+#pragma managed( pop )
\ No newline at end of file
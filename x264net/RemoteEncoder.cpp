@@ -0,0 +1,560 @@
+#include "RemoteEncoder.h"
+#include "x264net.h"
+#include "stringconvert.h"
+using namespace System::IO::MemoryMappedFiles;
+using namespace System::Threading;
+namespace x264net
+{
+	/// <summary>
+	/// <para>How often a side blocked on the other wakes up to check that the other process is still alive.</para>
+	/// </summary>
+	static const int LivenessPollMilliseconds = 100;
+
+	RemoteEncoder::RemoteEncoder(X264Options^ options)
+	{
+		String^ directory = System::IO::Path::GetDirectoryName(RemoteEncoder::typeid->Assembly->Location);
+		Open(options, System::IO::Path::Combine(directory, "X264NetHost.exe"), 4);
+	}
+	RemoteEncoder::RemoteEncoder(X264Options^ options, String^ hostPath, int slotCount)
+	{
+		Open(options, hostPath, slotCount);
+	}
+	void RemoteEncoder::Open(X264Options^ options, String^ hostPath, int slotCount)
+	{
+		if (slotCount < 1)
+			throw gcnew Exception("slotCount must be at least 1. Provided value: " + slotCount);
+		isDisposed = false;
+		this->options = options->Clone();
+		int slotSize = (int)((Int64)this->options->InputRowStride() * this->options->Height);
+		// Room for a couple of keyframes; a frame whose output cannot fit even in an empty ring is reported as an error.
+		int outputCapacity = (Math::Max(slotSize, 1 << 20) * 2 + 7) & ~7;
+		array<Byte>^ serialized = Text::Encoding::UTF8->GetBytes(EncoderHost::SerializeOptions(this->options));
+		String^ name = "x264net-" + Guid::NewGuid().ToString("N");
+		try
+		{
+			memory = MemoryMappedFile::CreateNew(name, (Int64)HostChannel::TotalSize(slotCount, slotSize, outputCapacity, serialized->Length));
+			view = memory->CreateViewAccessor();
+			unsigned char* base = nullptr;
+			view->SafeMemoryMappedViewHandle->AcquirePointer(base);
+			channel = new HostChannel(base);
+			{
+				pin_ptr<Byte> pinned = &serialized[0];
+				channel->Initialize(slotCount, slotSize, outputCapacity, pinned, serialized->Length);
+			}
+			frameReady = gcnew EventWaitHandle(false, EventResetMode::AutoReset, EncoderHost::EventName(name, "frame"));
+			slotFree = gcnew EventWaitHandle(false, EventResetMode::AutoReset, EncoderHost::EventName(name, "slot"));
+			outputReady = gcnew EventWaitHandle(false, EventResetMode::AutoReset, EncoderHost::EventName(name, "output"));
+			outputFree = gcnew EventWaitHandle(false, EventResetMode::AutoReset, EncoderHost::EventName(name, "space"));
+
+			System::Diagnostics::ProcessStartInfo^ start = gcnew System::Diagnostics::ProcessStartInfo(hostPath, name + " " + System::Diagnostics::Process::GetCurrentProcess()->Id);
+			start->UseShellExecute = false;
+			start->CreateNoWindow = true;
+			host = System::Diagnostics::Process::Start(start);
+
+			System::Diagnostics::Stopwatch^ waited = System::Diagnostics::Stopwatch::StartNew();
+			while (channel->HostState() == 0)
+			{
+				if (host->HasExited)
+					throw gcnew Exception("The encoder host exited during startup with exit code " + host->ExitCode);
+				if (waited->ElapsedMilliseconds > 30000)
+					throw gcnew Exception("The encoder host did not open an encoder within 30 seconds.");
+				outputReady->WaitOne(LivenessPollMilliseconds);
+			}
+			if (channel->HostState() < 0)
+				throw gcnew Exception("The encoder host could not open an encoder: " + gcnew String(channel->Error()));
+		}
+		catch (Exception^)
+		{
+			Close();
+			throw;
+		}
+	}
+	RemoteEncoder::~RemoteEncoder()
+	{
+		if (isDisposed)
+			return;
+		isDisposed = true;
+		// Ask the host to exit cleanly if it can take the request right away; otherwise it is stuck or gone.
+		if (!host->HasExited && channel->NextFreeSlot() >= 0)
+		{
+			channel->CommitSlot(0, HostFrameStop);
+			frameReady->Set();
+		}
+		Close();
+	}
+	RemoteEncoder::!RemoteEncoder()
+	{
+		if (channel)
+		{
+			delete channel;
+			channel = NULL;
+		}
+	}
+	void RemoteEncoder::Close()
+	{
+		if (host != nullptr)
+		{
+			if (!host->WaitForExit(5000))
+			{
+				try
+				{
+					host->Kill();
+				}
+				catch (InvalidOperationException^)
+				{
+					// It exited in the meantime.
+				}
+			}
+			delete host;
+		}
+		// The channel exists only while the view's pointer is acquired.
+		if (channel)
+			view->SafeMemoryMappedViewHandle->ReleasePointer();
+		this->!RemoteEncoder();
+		delete view;
+		delete memory;
+		delete frameReady;
+		delete slotFree;
+		delete outputReady;
+		delete outputFree;
+	}
+	int RemoteEncoder::FramesInFlight::get()
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("RemoteEncoder");
+		return (int)channel->FramesInFlight();
+	}
+	bool RemoteEncoder::HostExited::get()
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("RemoteEncoder");
+		return host->HasExited;
+	}
+	int RemoteEncoder::SlotSize::get()
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("RemoteEncoder");
+		return channel->SlotSize();
+	}
+	void RemoteEncoder::CheckHost()
+	{
+		if (host->HasExited)
+			throw gcnew Exception("The encoder host exited unexpectedly with exit code " + host->ExitCode);
+	}
+	Int64 RemoteEncoder::WaitForSlot()
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("RemoteEncoder");
+		Int64 slot;
+		while ((slot = channel->NextFreeSlot()) < 0)
+		{
+			CheckHost();
+			slotFree->WaitOne(LivenessPollMilliseconds);
+		}
+		return slot;
+	}
+	Int64 RemoteEncoder::Commit(Int64 timestamp, int flags)
+	{
+		Int64 slot = WaitForSlot();
+		channel->CommitSlot(timestamp, flags);
+		frameReady->Set();
+		return slot;
+	}
+	IntPtr RemoteEncoder::BeginFrame()
+	{
+		return IntPtr(channel->SlotData(WaitForSlot()));
+	}
+	void RemoteEncoder::CommitFrame()
+	{
+		Commit(0, 0);
+	}
+	void RemoteEncoder::CommitFrame(Int64 timestamp)
+	{
+		Commit(timestamp, HostFrameHasTimestamp);
+	}
+	/// <summary>
+	/// <para>Reads and consumes the next output record, if there is one.  An error record sets data to the host's message and failed to true instead of throwing, so the caller can finish reading the records it is waiting for first.</para>
+	/// </summary>
+	bool RemoteEncoder::ReadOutput(Int64% frame, array<Byte>^% data, bool% failed)
+	{
+		const HostOutputRecord* record = channel->PeekOutput();
+		if (!record)
+			return false;
+		frame = record->frame;
+		int flags = record->flags;
+		data = gcnew array<Byte>(record->size);
+		if (record->size > 0)
+			Runtime::InteropServices::Marshal::Copy(IntPtr((void*)(record + 1)), data, 0, record->size);
+		channel->ConsumeOutput(record);
+		outputFree->Set();
+		failed = (flags & HostOutputError) != 0;
+		return true;
+	}
+	Exception^ RemoteEncoder::HostError(array<Byte>^ message)
+	{
+		return gcnew Exception("The encoder host failed: " + Text::Encoding::UTF8->GetString(message));
+	}
+	array<Byte>^ RemoteEncoder::TakeOutput(int timeoutMilliseconds)
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("RemoteEncoder");
+		System::Diagnostics::Stopwatch^ waited = System::Diagnostics::Stopwatch::StartNew();
+		while (true)
+		{
+			Int64 frame;
+			array<Byte>^ data;
+			bool failed;
+			if (ReadOutput(frame, data, failed))
+			{
+				if (failed)
+					throw HostError(data);
+				return data;
+			}
+			CheckHost();
+			Int64 remaining = timeoutMilliseconds < 0 ? LivenessPollMilliseconds : timeoutMilliseconds - waited->ElapsedMilliseconds;
+			if (remaining <= 0)
+				return nullptr;
+			outputReady->WaitOne((int)Math::Min(remaining, (Int64)LivenessPollMilliseconds));
+		}
+	}
+	array<Byte>^ RemoteEncoder::WaitForOutput(Int64 frame)
+	{
+		// Usually the only record waiting is the frame's own, which is returned as read.  Earlier output not yet taken is joined in front of it.
+		Collections::Generic::List<array<Byte>^>^ earlier = nullptr;
+		// An error for an earlier frame is only thrown once this frame's record has been read, so the next call does not return this frame's output.
+		Exception^ error = nullptr;
+		while (true)
+		{
+			Int64 answered;
+			array<Byte>^ data;
+			bool failed;
+			while (ReadOutput(answered, data, failed))
+			{
+				if (failed)
+				{
+					if (error == nullptr)
+						error = HostError(data);
+					if (answered == frame)
+						throw error;
+					continue;
+				}
+				if (answered == frame && error != nullptr)
+					throw error;
+				if (answered == frame && earlier == nullptr)
+					return data;
+				if (earlier == nullptr)
+					earlier = gcnew Collections::Generic::List<array<Byte>^>();
+				earlier->Add(data);
+				if (answered == frame)
+				{
+					int size = 0;
+					for each (array<Byte>^ part in earlier)
+						size += part->Length;
+					array<Byte>^ joined = gcnew array<Byte>(size);
+					int offset = 0;
+					for each (array<Byte>^ part in earlier)
+					{
+						Buffer::BlockCopy(part, 0, joined, offset, part->Length);
+						offset += part->Length;
+					}
+					return joined;
+				}
+			}
+			CheckHost();
+			outputReady->WaitOne(LivenessPollMilliseconds);
+		}
+	}
+	array<Byte>^ RemoteEncoder::EncodeFrameAsWholeArray(array<Byte>^ rgb_data)
+	{
+		return EncodeFrameAsWholeArray(rgb_data, Int64::MinValue);
+	}
+	array<Byte>^ RemoteEncoder::EncodeFrameAsWholeArray(array<Byte>^ rgb_data, Int64 timestamp)
+	{
+		int topRow;
+		options->LocateInputRows(rgb_data, topRow);
+		IntPtr slot = BeginFrame();
+		Runtime::InteropServices::Marshal::Copy(rgb_data, 0, slot, Math::Min(rgb_data->Length, channel->SlotSize()));
+		return WaitForOutput(Commit(timestamp, timestamp == Int64::MinValue ? 0 : HostFrameHasTimestamp));
+	}
+	array<Byte>^ RemoteEncoder::Flush()
+	{
+		return WaitForOutput(Commit(0, HostFrameFlush));
+	}
+
+	/// <summary>
+	/// <para>Options are sent as one "name=value" line each.  Backslash, newline, and '=' are escaped so that any string survives, and an entry with no value (a null ParamOverrides value, meaning "true") has no '='.</para>
+	/// </summary>
+	void EncoderHost::AppendEscaped(Text::StringBuilder^ text, String^ value)
+	{
+		for (int i = 0; i < value->Length; i++)
+		{
+			wchar_t c = value[i];
+			if (c == L'\\')
+				text->Append(L"\\\\");
+			else if (c == L'\n')
+				text->Append(L"\\n");
+			else if (c == L'=')
+				text->Append(L"\\e");
+			else
+				text->Append(c);
+		}
+	}
+	String^ EncoderHost::Unescape(String^ value)
+	{
+		Text::StringBuilder^ text = gcnew Text::StringBuilder(value->Length);
+		for (int i = 0; i < value->Length; i++)
+		{
+			wchar_t c = value[i];
+			if (c == L'\\' && i + 1 < value->Length)
+			{
+				wchar_t escaped = value[++i];
+				text->Append(escaped == L'n' ? L'\n' : escaped == L'e' ? L'=' : escaped);
+			}
+			else
+				text->Append(c);
+		}
+		return text->ToString();
+	}
+	String^ EncoderHost::SerializeOptions(X264Options^ options)
+	{
+		Text::StringBuilder^ text = gcnew Text::StringBuilder();
+		for each (Reflection::FieldInfo^ field in X264Options::typeid->GetFields(Reflection::BindingFlags::Public | Reflection::BindingFlags::Instance))
+		{
+			Object^ value = field->GetValue(options);
+			if (value == nullptr)
+				continue;
+			if (field->Name == "ParamOverrides")
+			{
+				for each (Collections::Generic::KeyValuePair<String^, String^> pair in options->ParamOverrides)
+				{
+					text->Append("ParamOverrides.");
+					AppendEscaped(text, pair.Key);
+					if (pair.Value != nullptr)
+					{
+						text->Append(L'=');
+						AppendEscaped(text, pair.Value);
+					}
+					text->Append(L'\n');
+				}
+				continue;
+			}
+			String^ formatted;
+			if (value->GetType() == Double::typeid || value->GetType() == Single::typeid)
+				formatted = ((IFormattable^)value)->ToString("R", Globalization::CultureInfo::InvariantCulture);
+			else
+				formatted = Convert::ToString(value, Globalization::CultureInfo::InvariantCulture);
+			text->Append(field->Name)->Append(L'=');
+			AppendEscaped(text, formatted);
+			text->Append(L'\n');
+		}
+		return text->ToString();
+	}
+	X264Options^ EncoderHost::DeserializeOptions(String^ text)
+	{
+		X264Options^ options = gcnew X264Options();
+		for each (String^ line in text->Split(L'\n'))
+		{
+			if (line->Length == 0)
+				continue;
+			// Escaping leaves the separator as the only raw '='.
+			int separator = line->IndexOf(L'=');
+			String^ name = Unescape(separator < 0 ? line : line->Substring(0, separator));
+			String^ value = separator < 0 ? nullptr : Unescape(line->Substring(separator + 1));
+			if (name->StartsWith("ParamOverrides."))
+			{
+				if (options->ParamOverrides == nullptr)
+					options->ParamOverrides = gcnew Collections::Generic::List<Collections::Generic::KeyValuePair<String^, String^>>();
+				options->ParamOverrides->Add(Collections::Generic::KeyValuePair<String^, String^>(name->Substring(15), value));
+				continue;
+			}
+			Reflection::FieldInfo^ field = X264Options::typeid->GetField(name);
+			if (field == nullptr)
+				throw gcnew Exception("Unknown option from the client: " + name);
+			if (value == nullptr)
+				throw gcnew Exception("Option " + name + " from the client has no value");
+			if (field->FieldType->IsEnum)
+				field->SetValue(options, Enum::Parse(field->FieldType, value));
+			else
+				field->SetValue(options, Convert::ChangeType(value, field->FieldType, Globalization::CultureInfo::InvariantCulture));
+		}
+		return options;
+	}
+	/// <summary>
+	/// <para>The host's side of waiting for the client.  Once a frame's input has been converted and its output is ready, the input slot is given back before waiting for room in the output ring, so a client blocked on BeginFrame is never waiting on a host that is waiting on it.</para>
+	/// </summary>
+	ref class HostWaiter
+	{
+	public:
+		HostChannel* channel;
+		EventWaitHandle^ slotFree;
+		EventWaitHandle^ outputFree;
+		System::Diagnostics::Process^ client;
+		bool slotHeld;
+		bool ClientExited()
+		{
+			return client != nullptr && client->HasExited;
+		}
+		void ReleaseSlot()
+		{
+			if (!slotHeld)
+				return;
+			slotHeld = false;
+			channel->ReleaseSlot();
+			slotFree->Set();
+		}
+		/// <summary>
+		/// <para>Waits briefly for the client to read output.  Returns false if the client has exited.</para>
+		/// </summary>
+		bool WaitForOutputSpace()
+		{
+			ReleaseSlot();
+			if (ClientExited())
+				return false;
+			outputFree->WaitOne(LivenessPollMilliseconds);
+			return true;
+		}
+	};
+
+	int EncoderHost::Run(array<String^>^ args)
+	{
+		if (args->Length < 1)
+		{
+			Console::Error->WriteLine("Usage: X264NetHost <shared memory name> [client process id]");
+			return 2;
+		}
+		String^ name = args[0];
+		System::Diagnostics::Process^ client = nullptr;
+		if (args->Length > 1)
+		{
+			try
+			{
+				client = System::Diagnostics::Process::GetProcessById(Int32::Parse(args[1]));
+			}
+			catch (ArgumentException^)
+			{
+				return 0;
+			}
+		}
+		MemoryMappedFile^ memory = MemoryMappedFile::OpenExisting(name);
+		MemoryMappedViewAccessor^ view = memory->CreateViewAccessor();
+		unsigned char* base = nullptr;
+		view->SafeMemoryMappedViewHandle->AcquirePointer(base);
+		X264Net^ encoder = nullptr;
+		try
+		{
+			HostChannel channel(base);
+			if (!channel.IsValid())
+				return 3;
+			EventWaitHandle^ frameReady = EventWaitHandle::OpenExisting(EventName(name, "frame"));
+			EventWaitHandle^ slotFree = EventWaitHandle::OpenExisting(EventName(name, "slot"));
+			EventWaitHandle^ outputReady = EventWaitHandle::OpenExisting(EventName(name, "output"));
+			EventWaitHandle^ outputFree = EventWaitHandle::OpenExisting(EventName(name, "space"));
+
+			X264Options^ options;
+			try
+			{
+				array<Byte>^ serialized = gcnew array<Byte>(channel.OptionsSize());
+				Runtime::InteropServices::Marshal::Copy(IntPtr((void*)channel.Options()), serialized, 0, serialized->Length);
+				options = DeserializeOptions(Text::Encoding::UTF8->GetString(serialized));
+				encoder = gcnew X264Net(options);
+			}
+			catch (Exception^ ex)
+			{
+				channel.SetHostState(-1, getStdString(ex->Message).c_str());
+				outputReady->Set();
+				return 1;
+			}
+			channel.SetHostState(1, NULL);
+			outputReady->Set();
+
+			// Frame output goes from x264's buffer straight into the output ring.
+			HostWaiter^ waiter = gcnew HostWaiter();
+			waiter->channel = &channel;
+			waiter->slotFree = slotFree;
+			waiter->outputFree = outputFree;
+			waiter->client = client;
+			waiter->slotHeld = false;
+			encoder->outputChannel = &channel;
+			encoder->waitForOutputSpace = gcnew Func<bool>(waiter, &HostWaiter::WaitForOutputSpace);
+
+			// Slots hold the frame exactly as the client's byte array would, so locate the rows the same way EncodeFrame does.
+			int stride = options->InputRowStride();
+			int topRow = 0;
+			if (options->InputBottomUp)
+			{
+				topRow = stride * (options->Height - 1);
+				stride = -stride;
+			}
+			while (true)
+			{
+				Int64 index = channel.NextFullSlot();
+				if (index < 0)
+				{
+					if (waiter->ClientExited())
+						return 0;
+					frameReady->WaitOne(LivenessPollMilliseconds);
+					continue;
+				}
+				HostFrameSlot* slot = channel.Slot(index);
+				int flags = slot->flags;
+				if (flags & HostFrameStop)
+					return 0;
+				// The record still to be written after encoding, if the encoder did not write one itself.
+				array<Byte>^ data = nullptr;
+				int outputFlags = 0;
+				waiter->slotHeld = true;
+				try
+				{
+					if (flags & HostFrameFlush)
+					{
+						data = encoder->Flush();
+						outputFlags = HostOutputFlushed;
+					}
+					else
+					{
+						// Encode straight out of shared memory; x264 has its own copy of the picture once this returns.
+						encoder->outputFrame = index;
+						encoder->outputWritten = false;
+						const uint8_t* top = channel.SlotData(index) + topRow;
+						encoder->EncodeImage(top, stride, (flags & HostFrameHasTimestamp) ? slot->timestamp : encoder->NextTimestamp, 0, EncodeOutput::Channel);
+						if (!encoder->outputWritten)
+							data = array<Byte>::Empty;
+					}
+				}
+				catch (Exception^ ex)
+				{
+					data = Text::Encoding::UTF8->GetBytes(ex->Message);
+					outputFlags = HostOutputError;
+				}
+				waiter->ReleaseSlot();
+				if (data == nullptr)
+				{
+					outputReady->Set();
+					continue;
+				}
+				if (!channel.OutputFits(data->Length))
+				{
+					data = Text::Encoding::UTF8->GetBytes("The encoded frame (" + data->Length + " bytes) does not fit in the output ring.");
+					outputFlags = HostOutputError;
+				}
+				// Pin a zero-length array too, so an empty record has a valid source pointer.
+				array<Byte>^ source = data->Length > 0 ? data : gcnew array<Byte>(1);
+				pin_ptr<Byte> pinned = &source[0];
+				const uint8_t* bytes = pinned;
+				while (!channel.TryWriteOutput(bytes, data->Length, outputFlags, index))
+				{
+					if (!waiter->WaitForOutputSpace())
+						return 0;
+				}
+				outputReady->Set();
+			}
+		}
+		finally
+		{
+			delete encoder;
+			view->SafeMemoryMappedViewHandle->ReleasePointer();
+			delete view;
+			delete memory;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+#include "X264Options.h"
+#include "HostChannel.h"
+
+using namespace System;
+
+namespace x264net {
+
+	/// <summary>
+	/// <para>An encoder that runs x264 in a separate host process (X264NetHost.exe), so that a crash or runaway allocation in one encoder cannot take down the application.  Its methods mirror X264Net's.</para>
+	/// <para>Frames and encoded output travel through shared memory: the host encodes straight out of a ring of input slots and writes its output into a second ring, and named events signal each side.  Render into BeginFrame's slot and call CommitFrame to avoid copying frames at all; EncodeFrameAsWholeArray copies the array into a slot first, which is the same one copy a pipe would cost minus the kernel round trip.</para>
+	/// <para>If the host dies, the methods that wait for it throw, and HostExited becomes true; dispose this instance and create a new one to recover.  This instance must be disposed when you are finished with it.</para>
+	/// </summary>
+	public ref class RemoteEncoder
+	{
+	private:
+		System::IO::MemoryMappedFiles::MemoryMappedFile^ memory;
+		System::IO::MemoryMappedFiles::MemoryMappedViewAccessor^ view;
+		HostChannel* channel;
+		System::Threading::EventWaitHandle^ frameReady;
+		System::Threading::EventWaitHandle^ slotFree;
+		System::Threading::EventWaitHandle^ outputReady;
+		System::Threading::EventWaitHandle^ outputFree;
+		System::Diagnostics::Process^ host;
+		X264Options^ options;
+		bool isDisposed;
+		!RemoteEncoder();
+		void Open(X264Options^ options, String^ hostPath, int slotCount);
+		void Close();
+		void CheckHost();
+		Int64 WaitForSlot();
+		Int64 Commit(Int64 timestamp, int flags);
+		bool ReadOutput(Int64% frame, array<Byte>^% data, bool% failed);
+		static Exception^ HostError(array<Byte>^ message);
+		array<Byte>^ WaitForOutput(Int64 frame);
+	public:
+		/// <summary>
+		/// <para>The options the host encoder was opened with.  Changing them has no effect.</para>
+		/// </summary>
+		property X264Options^ Options { X264Options^ get() { return options; } }
+		/// <summary>
+		/// <para>The number of frames submitted and not yet encoded by the host.</para>
+		/// </summary>
+		property int FramesInFlight { int get(); }
+		/// <summary>
+		/// <para>True if the host process has exited.</para>
+		/// </summary>
+		property bool HostExited { bool get(); }
+		/// <summary>
+		/// <para>The size in bytes of a frame slot, which is how much BeginFrame's memory holds: Height rows of the input stride.</para>
+		/// </summary>
+		property int SlotSize { int get(); }
+
+		/// <summary>
+		/// <para>Starts a host process running X264NetHost.exe from the directory containing x264net.dll, with 4 frame slots.</para>
+		/// </summary>
+		RemoteEncoder(X264Options^ options);
+		/// <summary>
+		/// <para>Starts a host process and opens an encoder in it, waiting until the encoder is open.  Throws if the host cannot be started or rejects the options.</para>
+		/// </summary>
+		/// <param name="options">The encoding options.  They are copied to the host, so callbacks and other in-process state do not carry over.</param>
+		/// <param name="hostPath">The path of the host executable.</param>
+		/// <param name="slotCount">The number of frames that can be queued for the host at once.  More slots absorb jitter in the host's encoding time; fewer use less memory.</param>
+		RemoteEncoder(X264Options^ options, String^ hostPath, int slotCount);
+		~RemoteEncoder();
+
+		/// <summary>
+		/// <para>Waits for a free frame slot and returns a pointer to it.  Write the next frame there, laid out exactly as the byte array passed to EncodeFrameAsWholeArray would be, then call CommitFrame.  Call BeginFrame again without committing to get the same slot.</para>
+		/// </summary>
+		IntPtr BeginFrame();
+		/// <summary>
+		/// <para>Submits the frame written to BeginFrame's slot, with the next automatic timestamp.  Its output is returned by TakeOutput.</para>
+		/// </summary>
+		void CommitFrame();
+		/// <summary>
+		/// <para>Submits the frame written to BeginFrame's slot, with the specified timestamp.  Its output is returned by TakeOutput.</para>
+		/// </summary>
+		void CommitFrame(Int64 timestamp);
+		/// <summary>
+		/// <para>Returns the output of the oldest committed frame that has not been returned yet (possibly an empty array, if x264 delayed it), waiting up to timeoutMilliseconds for the host to finish it.  Returns null if it did not finish in time.  Use -1 to wait indefinitely.</para>
+		/// </summary>
+		array<Byte>^ TakeOutput(int timeoutMilliseconds);
+		/// <summary>
+		/// <para>Encodes a frame in the host process and waits for it, returning a single byte array containing one or more H.264 NAL units.  Output of frames committed earlier and not yet taken with TakeOutput is returned first, in the same array.</para>
+		/// </summary>
+		/// <param name="rgb_data">A byte array containing raw image data in Options.InputFormat, as for X264Net.EncodeFrameAsWholeArray.</param>
+		array<Byte>^ EncodeFrameAsWholeArray(array<Byte>^ rgb_data);
+		/// <summary>
+		/// <para>Encodes a frame captured at the specified time in the host process.  See the other overload.</para>
+		/// </summary>
+		array<Byte>^ EncodeFrameAsWholeArray(array<Byte>^ rgb_data, Int64 timestamp);
+		/// <summary>
+		/// <para>Encodes all frames the host's encoder is holding, returning any output not yet taken followed by the delayed frames.</para>
+		/// </summary>
+		array<Byte>^ Flush();
+	};
+
+	/// <summary>
+	/// <para>The encoding loop run by the host process started by RemoteEncoder.</para>
+	/// </summary>
+	public ref class EncoderHost abstract sealed
+	{
+	public:
+		/// <summary>
+		/// <para>Opens the shared memory named by the client, encodes frames until told to stop or until the client process exits, and returns the process exit code.  X264NetHost.exe passes its command line straight to this method.</para>
+		/// </summary>
+		static int Run(array<String^>^ args);
+	internal:
+		static String^ SerializeOptions(X264Options^ options);
+		static X264Options^ DeserializeOptions(String^ text);
+		static void AppendEscaped(Text::StringBuilder^ text, String^ value);
+		static String^ Unescape(String^ value);
+		static String^ EventName(String^ name, String^ suffix)
+		{
+			return name + "." + suffix;
+		}
+	};
+}
\ No newline at end of file
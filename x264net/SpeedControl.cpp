@@ -0,0 +1,102 @@
+#include "SpeedControl.h"
+
+#pragma managed( push, off )
+namespace x264net
+{
+	// Settings from fastest to slowest.  Each level is clamped to the encoder's original settings, and levels which would
+	// not be faster than the original are dropped, leaving the original itself as the slowest level.
+	static const unsigned int PartitionsNone = 0;
+	static const unsigned int PartitionsFast = X264_ANALYSE_I4x4 | X264_ANALYSE_I8x8 | X264_ANALYSE_PSUB16x16;
+	static const unsigned int PartitionsAll = X264_ANALYSE_I4x4 | X264_ANALYSE_I8x8 | X264_ANALYSE_PSUB16x16 | X264_ANALYSE_BSUB16x16;
+	static const struct
+	{
+		int subme;
+		int meMethod;
+		int references;
+		int trellis;
+		int mixedReferences;
+		unsigned int partitions;
+	} ladder[] =
+	{
+		{ 1, X264_ME_DIA, 1, 0, 0, PartitionsNone },
+		{ 2, X264_ME_DIA, 1, 0, 0, PartitionsFast },
+		{ 4, X264_ME_HEX, 1, 0, 0, PartitionsFast },
+		{ 6, X264_ME_HEX, 2, 1, 1, PartitionsAll },
+		{ 7, X264_ME_HEX, 3, 1, 1, PartitionsAll },
+		{ 8, X264_ME_UMH, 5, 1, 1, PartitionsAll },
+		{ 9, X264_ME_UMH, 8, 2, 1, PartitionsAll },
+	};
+
+	// Weight of the newest frame in the running average.
+	static const double Smoothing = 0.1;
+	// Step up to a slower level only when comfortably below budget, so the controller does not oscillate.
+	static const double StepUpThreshold = 0.7;
+	// Frames to wait after a change before stepping down again, and before stepping up.
+	static const int StepDownDelay = 4;
+	static const int StepUpDelay = 30;
+
+	static int Min(int a, int b)
+	{
+		return a < b ? a : b;
+	}
+
+	SpeedControl::SpeedControl(const x264_param_t& opened, double budgetSeconds)
+		: base(opened), levelCount(0), framesAtLevel(0), budget(budgetSeconds), average(0)
+	{
+		Settings original;
+		original.subme = base.analyse.i_subpel_refine;
+		original.meMethod = base.analyse.i_me_method;
+		original.references = base.i_frame_reference;
+		original.trellis = base.analyse.i_trellis;
+		original.mixedReferences = base.analyse.b_mixed_references;
+		original.partitions = base.analyse.inter;
+
+		for (int i = 0; i < (int)(sizeof(ladder) / sizeof(ladder[0])) && levelCount < MaxLevels - 1; i++)
+		{
+			Settings s;
+			// x264 cannot leave subme 0 or enter/leave exhaustive search once encoding has started.
+			s.subme = original.subme == 0 ? 0 : Min(ladder[i].subme, original.subme);
+			s.meMethod = original.meMethod >= X264_ME_ESA ? original.meMethod : Min(ladder[i].meMethod, original.meMethod);
+			s.references = Min(ladder[i].references, original.references);
+			s.trellis = Min(ladder[i].trellis, original.trellis);
+			s.mixedReferences = Min(ladder[i].mixedReferences, original.mixedReferences);
+			s.partitions = ladder[i].partitions & original.partitions;
+			if (s.subme == original.subme && s.meMethod == original.meMethod && s.references == original.references
+				&& s.trellis == original.trellis && s.mixedReferences == original.mixedReferences && s.partitions == original.partitions)
+				break;
+			levels[levelCount++] = s;
+		}
+		levels[levelCount++] = original;
+		level = levelCount - 1;
+	}
+	bool SpeedControl::Update(double frameSeconds, x264_param_t* tuned)
+	{
+		average = average == 0 ? frameSeconds : average + (frameSeconds - average) * Smoothing;
+		framesAtLevel++;
+
+		int newLevel = level;
+		// A single frame far over budget means a burst has started; react without waiting for the average to catch up.
+		if (level > 0 && framesAtLevel >= StepDownDelay && (average > budget || frameSeconds > budget * 2))
+			newLevel = level - 1;
+		else if (level < levelCount - 1 && framesAtLevel >= StepUpDelay && average < budget * StepUpThreshold)
+			newLevel = level + 1;
+		if (newLevel == level)
+			return false;
+
+		level = newLevel;
+		framesAtLevel = 0;
+		Apply(levels[level], tuned);
+		return true;
+	}
+	void SpeedControl::Apply(const Settings& settings, x264_param_t* tuned) const
+	{
+		*tuned = base;
+		tuned->analyse.i_subpel_refine = settings.subme;
+		tuned->analyse.i_me_method = settings.meMethod;
+		tuned->i_frame_reference = settings.references;
+		tuned->analyse.i_trellis = settings.trellis;
+		tuned->analyse.b_mixed_references = settings.mixedReferences;
+		tuned->analyse.inter = settings.partitions;
+	}
+}
+#pragma managed( pop )
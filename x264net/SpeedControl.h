@@ -0,0 +1,62 @@
+#pragma once
+#include "stdint.h"
+#include "lib/x264/include/x264.h"
+
+#pragma managed( push, off )
+namespace x264net
+{
+	/// <summary>
+	/// <para>Keeps a real-time encoder just inside its per-frame time budget by stepping analysis settings (subme, motion search, reference frames, trellis, partitions) up or down through x264_encoder_reconfig.</para>
+	/// <para>The settings the encoder was opened with are the slowest level; every other level is a faster subset of them, so speed control never spends more effort than the preset asked for.</para>
+	/// </summary>
+	class SpeedControl
+	{
+	public:
+		/// <summary>
+		/// <para>Creates a controller for an encoder opened with the given parameters (as returned by x264_encoder_parameters), starting at the slowest level.  budgetSeconds is the time each frame may take to convert and encode.</para>
+		/// </summary>
+		SpeedControl(const x264_param_t& opened, double budgetSeconds);
+		/// <summary>
+		/// <para>Records how long the last frame took.  Returns true if the level changed, in which case tuned has been filled in with the parameters to pass to x264_encoder_reconfig.</para>
+		/// </summary>
+		bool Update(double frameSeconds, x264_param_t* tuned);
+		/// <summary>
+		/// <para>The current level, from 0 (fastest) to LevelCount() - 1 (the encoder's original settings).</para>
+		/// </summary>
+		int Level() const
+		{
+			return level;
+		}
+		int LevelCount() const
+		{
+			return levelCount;
+		}
+		/// <summary>
+		/// <para>The smoothed time per frame, in seconds.</para>
+		/// </summary>
+		double AverageSeconds() const
+		{
+			return average;
+		}
+	private:
+		struct Settings
+		{
+			int subme;
+			int meMethod;
+			int references;
+			int trellis;
+			int mixedReferences;
+			unsigned int partitions;
+		};
+		static const int MaxLevels = 8;
+		void Apply(const Settings& settings, x264_param_t* tuned) const;
+		x264_param_t base;
+		Settings levels[MaxLevels];
+		int levelCount;
+		int level;
+		int framesAtLevel;
+		double budget;
+		double average;
+	};
+}
+#pragma managed( pop )
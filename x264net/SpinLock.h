@@ -0,0 +1,56 @@
+#pragma once
+#pragma managed( push, off )
+#include <atomic>
+#pragma managed( pop )
+
+#pragma managed( push, off )
+namespace x264net
+{
+	/// <summary>
+	/// <para>A minimal spin lock for guarding very short native critical sections (a handful of pointer copies).</para>
+	/// <para>std::mutex is not available when compiling with /clr, so native code that must be safe to call from several threads uses this instead.</para>
+	/// </summary>
+	class SpinLock
+	{
+	public:
+		SpinLock()
+		{
+			flag.clear();
+		}
+		void Lock()
+		{
+			while (flag.test_and_set(std::memory_order_acquire))
+			{
+			}
+		}
+		void Unlock()
+		{
+			flag.clear(std::memory_order_release);
+		}
+	private:
+		std::atomic_flag flag;
+		SpinLock(const SpinLock&);
+		SpinLock& operator=(const SpinLock&);
+	};
+
+	/// <summary>
+	/// <para>Holds a SpinLock for the lifetime of the guard object.</para>
+	/// </summary>
+	class SpinLockGuard
+	{
+	public:
+		explicit SpinLockGuard(SpinLock& lock) : lock(lock)
+		{
+			lock.Lock();
+		}
+		~SpinLockGuard()
+		{
+			lock.Unlock();
+		}
+	private:
+		SpinLock& lock;
+		SpinLockGuard(const SpinLockGuard&);
+		SpinLockGuard& operator=(const SpinLockGuard&);
+	};
+}
+#pragma managed( pop )
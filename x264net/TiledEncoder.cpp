@@ -0,0 +1,173 @@
+#include "TiledEncoder.h"
+#include "x264net.h"
+namespace x264net
+{
+	/// <summary>
+	/// <para>The state of one call to TiledEncoder.EncodeFrame, shared by its worker threads.</para>
+	/// </summary>
+	ref class TileJob
+	{
+	public:
+		array<X264Net^>^ tiles;
+		array<int>^ tileX;
+		array<int>^ tileY;
+		IntPtr rgb;
+		int rgbStride;
+		int bytesPerPixel;
+		bool hasTimestamp;
+		Int64 timestamp;
+		array<array<Byte>^>^ results;
+
+		void Encode(int tile)
+		{
+			// The tile's encoder reads its region of the canvas in place.
+			const uint8_t* origin = (const uint8_t*)rgb.ToPointer() + (ptrdiff_t)tileY[tile] * rgbStride + tileX[tile] * bytesPerPixel;
+			X264Net^ encoder = tiles[tile];
+			results[tile] = (array<Byte>^)encoder->EncodeImage(origin, rgbStride, hasTimestamp ? timestamp : encoder->NextTimestamp, 0, EncodeOutput::WholeArray);
+		}
+		void Flush(int tile)
+		{
+			results[tile] = tiles[tile]->Flush();
+		}
+	};
+
+	TiledEncoder::TiledEncoder(X264Options^ options, int columns, int rows) : Options(options), columns(columns), rows(rows)
+	{
+		if (columns < 1 || rows < 1)
+			throw gcnew ArgumentException("TiledEncoder requires at least 1 column and 1 row. Provided values: " + columns + " x " + rows);
+		isDisposed = false;
+		MaxParallelTiles = System::Environment::ProcessorCount;
+
+		array<int>^ columnWidths = Split(options->Width, columns, "Width");
+		array<int>^ rowHeights = Split(options->Height, rows, "Height");
+		int count = columns * rows;
+		tiles = gcnew array<X264Net^>(count);
+		tileX = gcnew array<int>(count);
+		tileY = gcnew array<int>(count);
+		tileWidth = gcnew array<int>(count);
+		tileHeight = gcnew array<int>(count);
+		try
+		{
+			int y = 0;
+			for (int row = 0; row < rows; row++)
+			{
+				int x = 0;
+				for (int column = 0; column < columns; column++)
+				{
+					int tile = row * columns + column;
+					tileX[tile] = x;
+					tileY[tile] = y;
+					tileWidth[tile] = columnWidths[column];
+					tileHeight[tile] = rowHeights[row];
+					X264Options^ tileOptions = options->Clone();
+					tileOptions->Width = columnWidths[column];
+					tileOptions->Height = rowHeights[row];
+					tiles[tile] = gcnew X264Net(tileOptions);
+					x += columnWidths[column];
+				}
+				y += rowHeights[row];
+			}
+		}
+		catch (Exception^)
+		{
+			this->~TiledEncoder();
+			throw;
+		}
+	}
+	TiledEncoder::~TiledEncoder()
+	{
+		if (isDisposed)
+			return;
+		for (int i = 0; i < tiles->Length; i++)
+		{
+			if (tiles[i] != nullptr)
+				delete tiles[i];
+			tiles[i] = nullptr;
+		}
+		isDisposed = true;
+	}
+	array<int>^ TiledEncoder::Split(int length, int parts, String^ dimension)
+	{
+		// Inner boundaries fall on macroblock (16 pixel) boundaries; the last part takes the remainder.
+		int size = (length / parts) / 16 * 16;
+		if (size < 16)
+			throw gcnew ArgumentException(dimension + " " + length + " is too small to split into " + parts + " tiles of at least 16 pixels");
+		array<int>^ sizes = gcnew array<int>(parts);
+		for (int i = 0; i < parts - 1; i++)
+			sizes[i] = size;
+		sizes[parts - 1] = length - size * (parts - 1);
+		return sizes;
+	}
+	void TiledEncoder::GetTileBounds(int tile, int% x, int% y, int% width, int% height)
+	{
+		if (tile < 0 || tile >= tiles->Length)
+			throw gcnew ArgumentOutOfRangeException("tile");
+		x = tileX[tile];
+		y = tileY[tile];
+		width = tileWidth[tile];
+		height = tileHeight[tile];
+	}
+	array<array<Byte>^>^ TiledEncoder::EncodeFrame(array<Byte>^ rgb_data)
+	{
+		return EncodeFrame_Internal(rgb_data, false, 0);
+	}
+	array<array<Byte>^>^ TiledEncoder::EncodeFrame(array<Byte>^ rgb_data, Int64 timestamp)
+	{
+		return EncodeFrame_Internal(rgb_data, true, timestamp);
+	}
+	array<array<Byte>^>^ TiledEncoder::EncodeFrame_Internal(array<Byte>^ rgb_data, bool hasTimestamp, Int64 timestamp)
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("TiledEncoder");
+		int topRow;
+		int stride = Options->LocateInputRows(rgb_data, topRow);
+
+		TileJob^ job = gcnew TileJob();
+		job->tiles = tiles;
+		job->tileX = tileX;
+		job->tileY = tileY;
+		job->rgbStride = stride;
+		job->bytesPerPixel = X264Options::BytesPerPixel(Options->InputFormat);
+		job->hasTimestamp = hasTimestamp;
+		job->timestamp = timestamp;
+		job->results = gcnew array<array<Byte>^>(tiles->Length);
+
+		System::Threading::Tasks::ParallelOptions^ parallelOptions = gcnew System::Threading::Tasks::ParallelOptions();
+		parallelOptions->MaxDegreeOfParallelism = Math::Max(1, MaxParallelTiles);
+		// The worker threads read the canvas through a raw pointer, so it must stay pinned until all tiles are done.
+		System::Runtime::InteropServices::GCHandle handle = System::Runtime::InteropServices::GCHandle::Alloc(rgb_data, System::Runtime::InteropServices::GCHandleType::Pinned);
+		try
+		{
+			job->rgb = IntPtr::Add(handle.AddrOfPinnedObject(), topRow);
+			System::Threading::Tasks::Parallel::For(0, tiles->Length, parallelOptions, gcnew Action<int>(job, &TileJob::Encode));
+		}
+		catch (AggregateException^ ex)
+		{
+			throw gcnew Exception("Tiled encoding failed: " + ex->InnerException->Message, ex->InnerException);
+		}
+		finally
+		{
+			handle.Free();
+		}
+		return job->results;
+	}
+	array<array<Byte>^>^ TiledEncoder::Flush()
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("TiledEncoder");
+		TileJob^ job = gcnew TileJob();
+		job->tiles = tiles;
+		job->results = gcnew array<array<Byte>^>(tiles->Length);
+		System::Threading::Tasks::ParallelOptions^ parallelOptions = gcnew System::Threading::Tasks::ParallelOptions();
+		parallelOptions->MaxDegreeOfParallelism = Math::Max(1, MaxParallelTiles);
+		try
+		{
+			System::Threading::Tasks::Parallel::For(0, tiles->Length, parallelOptions, gcnew Action<int>(job, &TileJob::Flush));
+		}
+		catch (AggregateException^ ex)
+		{
+			throw gcnew Exception("Tiled encoding failed: " + ex->InnerException->Message, ex->InnerException);
+		}
+		return job->results;
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "X264Options.h"
+
+using namespace System;
+
+namespace x264net {
+
+	ref class X264Net;
+
+	/// <summary>
+	/// <para>Encodes very large canvases (8K, video walls) by splitting each RGB frame into a grid of tiles and encoding every tile on its own encoder, in parallel.  Each tile is converted straight from the caller's buffer, so the frame is never copied or split up in memory.</para>
+	/// <para>Each tile produces an independent H.264 stream; a player or video wall controller decodes them separately and places them side by side.  Tile boundaries are multiples of 16 pixels where possible, so no tile needs padding except those on the right and bottom edges.</para>
+	/// <para>This instance must be disposed when you are finished with it.</para>
+	/// </summary>
+	public ref class TiledEncoder
+	{
+	private:
+		array<X264Net^>^ tiles;
+		array<int>^ tileX;
+		array<int>^ tileY;
+		array<int>^ tileWidth;
+		array<int>^ tileHeight;
+		int columns;
+		int rows;
+		bool isDisposed;
+		array<array<Byte>^>^ EncodeFrame_Internal(array<Byte>^ rgb_data, bool hasTimestamp, Int64 timestamp);
+		static array<int>^ Split(int length, int parts, String^ dimension);
+	public:
+		/// <summary>
+		/// <para>The options for the whole canvas.  Width and Height are the canvas size; every other option (including Threads) applies to each tile's encoder.</para>
+		/// </summary>
+		X264Options^ Options;
+		/// <summary>
+		/// <para>The maximum number of tiles to encode at once.  Default: the number of logical processors.</para>
+		/// </summary>
+		int MaxParallelTiles;
+
+		/// <summary>
+		/// <para>Create a TiledEncoder which splits the canvas into columns x rows tiles.</para>
+		/// </summary>
+		/// <param name="options">The encoding options.  Width and Height are the size of the whole canvas.</param>
+		/// <param name="columns">The number of tiles across.</param>
+		/// <param name="rows">The number of tiles down.</param>
+		TiledEncoder(X264Options^ options, int columns, int rows);
+		~TiledEncoder();
+		/// <summary>
+		/// <para>The number of tiles (columns * rows).  Tiles are numbered left to right, then top to bottom.</para>
+		/// </summary>
+		property int TileCount { int get() { return tiles->Length; } }
+		property int Columns { int get() { return columns; } }
+		property int Rows { int get() { return rows; } }
+		/// <summary>
+		/// <para>Gets the position and size, in canvas pixels, of a tile.</para>
+		/// </summary>
+		void GetTileBounds(int tile, [System::Runtime::InteropServices::Out] int% x, [System::Runtime::InteropServices::Out] int% y, [System::Runtime::InteropServices::Out] int% width, [System::Runtime::InteropServices::Out] int% height);
+		/// <summary>
+		/// <para>Encodes a frame of the whole canvas, returning one byte array of H.264 NAL units per tile, indexed by tile number.</para>
+		/// </summary>
+		/// <param name="rgb_data">A byte array containing raw image data in Options.InputFormat (by default RGB, 3 bytes / 24 bits per pixel) for the whole canvas.  This array's length must be equal to Width * Height * the bytes per pixel of the format.</param>
+		array<array<Byte>^>^ EncodeFrame(array<Byte>^ rgb_data);
+		/// <summary>
+		/// <para>Encodes a frame of the whole canvas captured at the specified time, returning one byte array of H.264 NAL units per tile, indexed by tile number.</para>
+		/// </summary>
+		/// <param name="rgb_data">A byte array containing raw image data in Options.InputFormat (by default RGB, 3 bytes / 24 bits per pixel) for the whole canvas.  This array's length must be equal to Width * Height * the bytes per pixel of the format.</param>
+		/// <param name="timestamp">The presentation time of the frame, in units of the timebase (see X264Options.TimebaseNumerator).</param>
+		array<array<Byte>^>^ EncodeFrame(array<Byte>^ rgb_data, Int64 timestamp);
+		/// <summary>
+		/// <para>Encodes any frames the tile encoders are still holding back, returning one byte array per tile.</para>
+		/// </summary>
+		array<array<Byte>^>^ Flush();
+	};
+}
@@ -0,0 +1,72 @@
+#include "TraceRing.h"
+#pragma managed( push, off )
+#include <cstdio>
+#pragma managed( pop )
+
+#pragma managed( push, off )
+namespace x264net
+{
+	TraceRing::TraceRing(int capacity) : capacity(capacity < 16 ? 16 : capacity), head(0)
+	{
+		slots = new Slot[this->capacity];
+		for (uint64_t i = 0; i < this->capacity; i++)
+			slots[i].version.store(0, std::memory_order_relaxed);
+	}
+	TraceRing::~TraceRing()
+	{
+		delete[] slots;
+	}
+	const char* TraceRing::StageName(TraceStage stage)
+	{
+		switch (stage)
+		{
+		case TraceStageFrame: return "Frame";
+		case TraceStageHash: return "Hash";
+		case TraceStageConvert: return "Convert";
+		case TraceStageEncode: return "Encode";
+		case TraceStagePublish: return "Publish";
+		case TraceStageCopyOut: return "CopyOut";
+		case TraceStageReconfig: return "Reconfig";
+		case TraceStageGarbageCollection: return "GC";
+		default: return "Unknown";
+		}
+	}
+	std::string TraceRing::Export(int64_t ticksPerSecond, int processId) const
+	{
+		double microsecondsPerTick = 1000000.0 / (double)ticksPerSecond;
+		uint64_t end = head.load(std::memory_order_acquire);
+		uint64_t start = end > capacity ? end - capacity : 0;
+		std::string json;
+		json.reserve((size_t)(end - start) * 128 + 64);
+		json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool first = true;
+		char line[256];
+		for (uint64_t index = start; index < end; index++)
+		{
+			const Slot& slot = slots[index % capacity];
+			uint64_t version = slot.version.load(std::memory_order_acquire);
+			if (version != index * 2 + 2)
+				continue; // Still being written, or already overwritten by a newer event.
+			int64_t begin = slot.begin.load(std::memory_order_relaxed);
+			int64_t finish = slot.end.load(std::memory_order_relaxed);
+			int64_t frame = slot.frame.load(std::memory_order_relaxed);
+			int threadId = slot.threadId.load(std::memory_order_relaxed);
+			int stage = slot.stage.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.version.load(std::memory_order_relaxed) != version)
+				continue;
+			const char* name = StageName((TraceStage)stage);
+			if (stage == TraceStageGarbageCollection)
+				snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"cat\":\"x264net\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"frame\":%lld}}",
+					first ? "" : ",", name, begin * microsecondsPerTick, processId, threadId, (long long)frame);
+			else
+				snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"cat\":\"x264net\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"frame\":%lld}}",
+					first ? "" : ",", name, begin * microsecondsPerTick, (finish - begin) * microsecondsPerTick, processId, threadId, (long long)frame);
+			json += line;
+			first = false;
+		}
+		json += "\n]}";
+		return json;
+	}
+}
+#pragma managed( pop )
@@ -0,0 +1,86 @@
+#pragma once
+#include "stdint.h"
+#pragma managed( push, off )
+#include <atomic>
+#include <string>
+#pragma managed( pop )
+
+#pragma managed( push, off )
+namespace x264net
+{
+	/// <summary>
+	/// <para>The pipeline stages recorded by TraceRing.</para>
+	/// </summary>
+	enum TraceStage
+	{
+		/// <summary>An entire call to EncodeFrame (or a variant), from entry to return.</summary>
+		TraceStageFrame = 0,
+		/// <summary>Hashing the input to detect duplicate frames.</summary>
+		TraceStageHash,
+		/// <summary>Converting RGB input to YUV.</summary>
+		TraceStageConvert,
+		/// <summary>The x264_encoder_encode call, including any wait for x264's frame threads.</summary>
+		TraceStageEncode,
+		/// <summary>Sharing the output with the GOP cache and broadcaster.</summary>
+		TraceStagePublish,
+		/// <summary>Copying the output into managed arrays.</summary>
+		TraceStageCopyOut,
+		/// <summary>Applying new settings with x264_encoder_reconfig.</summary>
+		TraceStageReconfig,
+		/// <summary>An instant event: one or more garbage collections happened during the frame.</summary>
+		TraceStageGarbageCollection,
+		TraceStageCount
+	};
+
+	/// <summary>
+	/// <para>A fixed-size, lock-free ring of timeline events which can be exported as Chrome trace-event JSON (viewable in chrome://tracing or Perfetto).</para>
+	/// <para>Add() may be called from any number of threads without locking; once the ring is full, the oldest events are overwritten.  Times are in arbitrary ticks (Stopwatch timestamps), converted to microseconds on export.</para>
+	/// </summary>
+	class TraceRing
+	{
+	public:
+		explicit TraceRing(int capacity);
+		~TraceRing();
+		/// <summary>
+		/// <para>Records that a stage ran from begin to end (equal for instant events) on the given thread while handling the given frame.</para>
+		/// </summary>
+		void Add(TraceStage stage, int64_t begin, int64_t end, int64_t frame, int threadId)
+		{
+			uint64_t index = head.fetch_add(1, std::memory_order_relaxed);
+			Slot& slot = slots[index % capacity];
+			// An odd version marks the slot as being written, so that Export() skips it.
+			slot.version.store(index * 2 + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			slot.begin.store(begin, std::memory_order_relaxed);
+			slot.end.store(end, std::memory_order_relaxed);
+			slot.frame.store(frame, std::memory_order_relaxed);
+			slot.threadId.store(threadId, std::memory_order_relaxed);
+			slot.stage.store((int)stage, std::memory_order_relaxed);
+			slot.version.store(index * 2 + 2, std::memory_order_release);
+		}
+		/// <summary>
+		/// <para>Returns the events currently in the ring, oldest first, as a Chrome trace-event JSON document.  ticksPerSecond is the frequency of the timestamps passed to Add().  May be called while other threads are adding events; events being written at that moment are left out.</para>
+		/// </summary>
+		std::string Export(int64_t ticksPerSecond, int processId) const;
+		/// <summary>
+		/// <para>Returns the display name of a stage.</para>
+		/// </summary>
+		static const char* StageName(TraceStage stage);
+	private:
+		struct Slot
+		{
+			std::atomic<uint64_t> version;
+			std::atomic<int64_t> begin;
+			std::atomic<int64_t> end;
+			std::atomic<int64_t> frame;
+			std::atomic<int> threadId;
+			std::atomic<int> stage;
+		};
+		Slot* slots;
+		uint64_t capacity;
+		std::atomic<uint64_t> head;
+		TraceRing(const TraceRing&);
+		TraceRing& operator=(const TraceRing&);
+	};
+}
+#pragma managed( pop )
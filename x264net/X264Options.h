@@ -1,10 +1,28 @@
 #pragma once
+using namespace System;
+
 namespace x264net
 {
 	public enum class X264Preset : __int32 { ultrafast, superfast, veryfast, faster, fast, medium, slow, slower, veryslow, placebo };
 	public enum class X264Tune : __int32 { film, animation, grain, stillimage, psnr, ssim, fastdecode, zerolatency };
 	public enum class X264Profile : __int32 { baseline, main, high, high10, high422, high444 };
 	//public enum class X264Colorspace : __int32 { I420, I422, I444 };
+	public enum class X264ColorMatrix : __int32 { BT601, BT709, BT2020 };
+	/// <summary>
+	/// <para>Byte layouts of packed pixel data.  RGB24: 3 bytes per pixel, red first.  BGR24: 3 bytes per pixel, blue first (System.Drawing's Format24bppRgb).  BGRA32: 4 bytes per pixel, blue first, the fourth byte ignored (Format32bppArgb / Format32bppRgb).  Gray8: 1 byte per pixel, brightness only (monochrome and IR cameras).</para>
+	/// </summary>
+	public enum class X264PixelFormat : __int32 { RGB24, BGR24, BGRA32, Gray8 };
+	/// <summary>
+	/// <para>Memory layouts of the YUV 4:2:0 picture handed to x264.  I420: separate U and V planes.  NV12: one plane of interleaved U and V, which is how x264 stores frames internally, so it saves x264 a repacking pass over the chroma of every frame.</para>
+	/// </summary>
+	public enum class X264PictureFormat : __int32 { I420, NV12 };
+	/// <summary>
+	/// <para>How the encoder handles a frame that is byte-identical to the previous one.</para>
+	/// <para>Off: every frame is converted and encoded normally.</para>
+	/// <para>Skip: the frame is dropped without being converted or encoded, and the encoder returns no data for it.  The next frame that is encoded carries a timestamp reflecting the gap, so rate control still sees the real frame rate.  Viewers keep showing the last frame.</para>
+	/// <para>EncodeAsSkip: the frame is not converted, and the encoder is told that every macroblock is unchanged, so it produces a tiny P frame at almost no CPU cost.  Use this when downstream needs one output frame per input frame.</para>
+	/// </summary>
+	public enum class X264DuplicateFrameMode : __int32 { Off, Skip, EncodeAsSkip };
 
 	public ref class X264Options
 	{
@@ -26,6 +44,39 @@ namespace x264net
 		/// </summary>
 		//X264Colorspace Colorspace = X264Colorspace::I420;
 
+		/// <summary>
+		/// <para>The matrix used to convert RGB input to YUV, which is also signaled in the stream's VUI so players convert back with the same matrix.  Use BT601 for SD content, BT709 for HD content, and BT2020 for UHD content.  Default: BT601</para>
+		/// </summary>
+		X264ColorMatrix ColorMatrix = X264ColorMatrix::BT601;
+		/// <summary>
+		/// <para>If true, RGB input is converted to full range ("PC", 0-255) YUV instead of limited range ("TV", 16-235), and the stream is flagged accordingly.  Default: false</para>
+		/// </summary>
+		bool FullRange = false;
+		/// <summary>
+		/// <para>The byte layout of the frames passed to EncodeFrame.  BGR24 and BGRA32 match Windows bitmaps and screen capture, and are converted without reordering the bytes first.  Gray8 frames are copied straight to luma with no chroma to compute, and the encoder skips chroma motion estimation.  Default: RGB24</para>
+		/// </summary>
+		X264PixelFormat InputFormat = X264PixelFormat::RGB24;
+		/// <summary>
+		/// <para>The layout of the YUV picture that input frames are converted into.  NV12 saves x264 a pass over the chroma of every frame.  MosaicEncoder requires I420.  Default: I420</para>
+		/// </summary>
+		X264PictureFormat PictureFormat = X264PictureFormat::I420;
+		/// <summary>
+		/// <para>If true, each frame is encoded on a background thread while the caller converts the next one into a second input picture, so conversion and encoding overlap instead of taking turns.  The encoded stream is the same, but each call returns the output of the frame submitted by the call before it; Flush returns the last one.  MosaicEncoder requires this to be false.  Default: false</para>
+		/// </summary>
+		bool OverlapConversion = false;
+		/// <summary>
+		/// <para>If true, RGB24, BGR24, and BGRA32 frames whose red, green, and blue are equal everywhere (e.g. a camera in IR night mode) are recognized and encoded like Gray8 input until color returns.  Ignored for Gray8 input, which is always encoded as gray.  Checking a color frame stops at its first colored pixel, so this costs almost nothing.  Default: false</para>
+		/// </summary>
+		bool DetectGrayscale = false;
+		/// <summary>
+		/// <para>The distance in bytes from the start of one row of an input frame to the start of the next, for rows padded to an alignment (e.g. 4 bytes for Windows DIBs).  0 means rows are tightly packed (Width * bytes per pixel).  Default: 0</para>
+		/// </summary>
+		int InputStride = 0;
+		/// <summary>
+		/// <para>If true, input frames store their bottom row first, as Windows DIBs and GDI capture do.  Rows are read in reverse order in place; the frame is never flipped or copied.  Default: false</para>
+		/// </summary>
+		bool InputBottomUp = false;
+
 		/// <summary>
 		/// <para>The width of the video, in pixels.</para>
 		/// </summary>
@@ -54,6 +105,21 @@ namespace x264net
 		/// </summary>
 		bool ConstantBitRate = false;
 
+		/// <summary>
+		/// <para>(i_bitrate) The average bit rate to target, in kbps, when encoding in multiple passes (Pass > 0).  Ignored otherwise.</para>
+		/// </summary>
+		int AverageBitRate = -1;
+
+		/// <summary>
+		/// <para>Multi-pass rate control.  0: a normal single-pass encode (default).  1: first pass; writes StatsFile using fast first-pass settings.  2: final pass; reads StatsFile and hits AverageBitRate.  3: middle pass; reads and then rewrites StatsFile.  See MultiPassEncoder for a simple way to run all passes.</para>
+		/// </summary>
+		int Pass = 0;
+
+		/// <summary>
+		/// <para>The file the multi-pass statistics are written to and read from when Pass > 0.  x264 also creates a ".mbtree" file next to it.</para>
+		/// </summary>
+		String^ StatsFile = nullptr;
+
 		/// <summary>
 		/// <para>(f_rf_constant) A CRF quality value to target when encoding in Variable Bit Rate mode.  Lower is better quality.  17 is extremely good quality.  23 is still quite good.  Our default is 25.</para>
 		/// </summary>
@@ -65,10 +131,40 @@ namespace x264net
 		float QualityMinimum = 35;
 
 		/// <summary>
-		/// <para>The targeted FPS, important for the encoder to optimize bit rate allocation.  Fractional values are not currently supported.</para>
+		/// <para>The targeted FPS, important for the encoder to optimize bit rate allocation.  For fractional frame rates, this is the numerator and FPSDenominator is the denominator (e.g. 30000 / 1001 for 29.97).</para>
 		/// </summary>
 		int FPS = 10;
 
+		/// <summary>
+		/// <para>The denominator of the frame rate.  The frame rate is FPS / FPSDenominator.  Default: 1</para>
+		/// </summary>
+		int FPSDenominator = 1;
+
+		/// <summary>
+		/// <para>The numerator of the timebase in which frame timestamps are expressed, in seconds per unit.  When TimebaseNumerator and TimebaseDenominator are both set, rate control follows the timestamps passed to EncodeFrame (variable frame rate input) rather than assuming every frame lasts exactly 1 / FPS, so frames need not be submitted during idle periods.  For example, 1 / 1000 for millisecond timestamps, or 1 / 10000000 for DateTime ticks.  Set both to 0 to use a timebase of one unit per frame (FPSDenominator / FPS).  Default: 0</para>
+		/// </summary>
+		int TimebaseNumerator = 0;
+
+		/// <summary>
+		/// <para>The denominator of the timebase in which frame timestamps are expressed.  See TimebaseNumerator.  Default: 0</para>
+		/// </summary>
+		int TimebaseDenominator = 0;
+
+		/// <summary>
+		/// <para>If true, the encoder measures how long each frame takes to convert and encode and adjusts its analysis settings (subme, motion search, reference frames, trellis, partitions) while running, so that it keeps up with FPS.  Settings are never raised above those of the chosen Preset and Tune; spare time is used to return toward them.  Default: false</para>
+		/// </summary>
+		bool AdaptiveSpeed = false;
+
+		/// <summary>
+		/// <para>When AdaptiveSpeed is enabled, the fraction of each frame interval (FPSDenominator / FPS) that encoding may use.  Lower values leave more headroom for bursts and for other work on the same thread.  Default: 0.8</para>
+		/// </summary>
+		double AdaptiveSpeedTargetLoad = 0.8;
+
+		/// <summary>
+		/// <para>How to handle a frame that is byte-identical to the previous one, as is common with screen capture or paused cameras.  Duplicates are recognized by hashing the input.  See X264DuplicateFrameMode.  Default: Off</para>
+		/// </summary>
+		X264DuplicateFrameMode DuplicateFrames = X264DuplicateFrameMode::Off;
+
 		/// <summary>
 		/// <para>The number of frames between iframes.  Default: 300</para>
 		/// </summary>
@@ -79,6 +175,112 @@ namespace x264net
 		/// </summary>
 		bool IntraRefresh = true;
 
+		/// <summary>
+		/// <para>If true, the encoder keeps every encoded frame since the most recent keyframe so that X264Net.JoinSnapshot() can give a newly joined viewer everything it needs to start decoding immediately, without forcing a new keyframe.  Default: false</para>
+		/// </summary>
+		bool EnableGopCache = false;
+
+		/// <summary>
+		/// <para>The maximum number of frames the GOP cache may hold.  If a GOP grows longer than this, JoinSnapshot() returns null until the next keyframe.  Set to 0 or below to use IframeInterval.  Default: 0</para>
+		/// </summary>
+		int GopCacheMaxFrames = 0;
+
+		/// <summary>
+		/// <para>If true, the encoder records the start and duration of each stage of every frame (hashing, conversion, encoding, publishing, copying out, reconfiguration, and garbage collections) in a lock-free ring, which X264Net.ExportTrace() returns as Chrome trace-event JSON.  When false, tracing costs one branch per stage.  Default: false</para>
+		/// </summary>
+		bool EnableTracing = false;
+
+		/// <summary>
+		/// <para>The number of trace events kept when EnableTracing is true.  Older events are overwritten.  Each frame typically records 4 to 6 events.  Default: 65536</para>
+		/// </summary>
+		int TraceCapacity = 65536;
+
+		/// <summary>
+		/// <para>Raw x264 parameters to set, in order, using the same names and values as the x264 command line without the leading dashes (e.g. "rc-lookahead" = "10", "bframes" = "0", "sliced-threads" = "1", "lookahead-threads" = "2", "deterministic" = "0").  A null value means "true" for boolean parameters.</para>
+		/// <para>These are applied with x264_param_parse after the Preset, Tune, and every other option in this class, and before Profile, so they override everything except the profile's restrictions.  Use SetParam to add entries.  X264Net.GetEffectiveParameters() shows the values the encoder actually used.  Default: null</para>
+		/// </summary>
+		System::Collections::Generic::List<System::Collections::Generic::KeyValuePair<String^, String^>>^ ParamOverrides = nullptr;
+
+		/// <summary>
+		/// <para>Adds a raw x264 parameter to ParamOverrides, creating the list if necessary.</para>
+		/// </summary>
+		/// <param name="name">The x264 parameter name, as used on the command line without the leading dashes.</param>
+		/// <param name="value">The value, or null for "true".</param>
+		void SetParam(String^ name, String^ value)
+		{
+			if (ParamOverrides == nullptr)
+				ParamOverrides = gcnew System::Collections::Generic::List<System::Collections::Generic::KeyValuePair<String^, String^>>();
+			ParamOverrides->Add(System::Collections::Generic::KeyValuePair<String^, String^>(name, value));
+		}
+
+		/// <summary>
+		/// <para>The number of bytes per pixel of the given layout.</para>
+		/// </summary>
+		static int BytesPerPixel(X264PixelFormat format)
+		{
+			switch (format)
+			{
+			case X264PixelFormat::BGRA32:
+				return 4;
+			case X264PixelFormat::Gray8:
+				return 1;
+			default:
+				return 3;
+			}
+		}
+
+	internal:
+		/// <summary>
+		/// <para>The distance in bytes between the starts of consecutive rows of an input frame in memory: InputStride, or Width * bytes per pixel if InputStride is 0.</para>
+		/// </summary>
+		int InputRowStride()
+		{
+			int rowBytes = Width * BytesPerPixel(InputFormat);
+			if (InputStride == 0)
+				return rowBytes;
+			if (InputStride < rowBytes)
+				throw gcnew Exception("InputStride must be 0 or at least Width * bytes per pixel (" + rowBytes + "). Provided value: " + InputStride);
+			return InputStride;
+		}
+		/// <summary>
+		/// <para>Checks that data holds one frame in InputFormat laid out as InputStride and InputBottomUp describe.  Returns the signed distance from each row to the row below it, and sets topRow to the offset of the top row in data.</para>
+		/// </summary>
+		int LocateInputRows(array<Byte>^ data, int% topRow)
+		{
+			int bytesPerPixel = BytesPerPixel(InputFormat);
+			int rowBytes = Width * bytesPerPixel;
+			int stride = InputRowStride();
+			if (InputStride == 0)
+			{
+				if (data->Length != Width * Height * bytesPerPixel)
+					throw gcnew ArgumentException("Input image data has size " + data->Length + " but the expected size is " + (Width * Height * bytesPerPixel) + " (" + Width + " * " + Height + " * " + bytesPerPixel + ")", "rgb_data");
+			}
+			else
+			{
+				Int64 required = (Int64)stride * (Height - 1) + rowBytes;
+				if (data->Length < required)
+					throw gcnew ArgumentException("Input image data has size " + data->Length + " but the expected size is at least " + required + " (" + stride + " * " + (Height - 1) + " + " + rowBytes + ")", "rgb_data");
+			}
+			if (InputBottomUp)
+			{
+				topRow = stride * (Height - 1);
+				return -stride;
+			}
+			topRow = 0;
+			return stride;
+		}
+	public:
+		/// <summary>
+		/// <para>Returns a copy of these options.</para>
+		/// </summary>
+		X264Options^ Clone()
+		{
+			X264Options^ clone = (X264Options^)MemberwiseClone();
+			if (ParamOverrides != nullptr)
+				clone->ParamOverrides = gcnew System::Collections::Generic::List<System::Collections::Generic::KeyValuePair<String^, String^>>(ParamOverrides);
+			return clone;
+		}
+
 		/// <summary>
 		/// <para>Create an X264Options instance with default values and no Width or Height assigned.</para>
 		/// </summary>
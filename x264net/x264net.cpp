@@ -1,6 +1,5 @@
 // This is the main DLL file.
 #include "x264net.h"
-#include "RGB_To_YUV420.h"
 #include "stringconvert.h"
 #include <exception>
 namespace x264net
@@ -13,11 +12,60 @@ namespace x264net
 	/// <param name="options">The encoding options to use.</param>
 	X264Net::X264Net(X264Options^ options) : Options(options)
 	{
+		stitchable = false;
+		firstPts = 0;
+		Initialize();
+	}
+	/// <summary>
+	/// <para>Used by ChunkedEncoder.  A stitchable encoder produces SPS/PPS which do not depend on the video content, so the output of several encoders with the same options can be concatenated.  Presentation timestamps start at frame number firstPts instead of 0.</para>
+	/// </summary>
+	X264Net::X264Net(X264Options^ options, bool stitchable, int64_t firstPts) : Options(options)
+	{
+		this->stitchable = stitchable;
+		this->firstPts = firstPts;
 		Initialize();
 	}
 	void X264Net::Initialize()
 	{
 		isDisposed = false;
+		disposeLock = gcnew Object();
+		gopCache = NULL;
+		bufferPool = NULL;
+		broadcastRing = NULL;
+		speedControl = NULL;
+		constantMbInfo = NULL;
+		grayToLuma = NULL;
+		convertGray = NULL;
+		grayscaleInput = false;
+		chromaNeutral = false;
+		interleavedChroma = false;
+		previousHash = 0;
+		hasPreviousFrame = false;
+		duplicateFrameCount = 0;
+		recordPool = NULL;
+		traceRing = NULL;
+		tracePts = -1;
+		traceGcCount = 0;
+		pendingSei = NULL;
+		appendTarget = NULL;
+		outputChannel = NULL;
+		outputFrame = 0;
+		outputWritten = false;
+		waitForOutputSpace = nullptr;
+		multiplexMember = nullptr;
+		ownedByMosaic = false;
+		Overlays = gcnew System::Collections::Generic::List<OsdOverlay^>();
+		statsFile = NULL;
+		encoder = NULL;
+		pic_in = NULL;
+		spareInput = NULL;
+		spareChromaNeutral = false;
+		picturePool = NULL;
+		pendingEncode = nullptr;
+		submittedInput = NULL;
+		pendingRecord = NULL;
+		pendingNals = NULL;
+		pendingNalCount = 0;
 		try
 		{
 			if (Options->Width % 2 != 0 || Options->Height % 2 != 0)
@@ -26,11 +74,14 @@ namespace x264net
 				Options->Threads = 1;
 			if (Options->Threads > System::Environment::ProcessorCount * 2)
 				Options->Threads = System::Environment::ProcessorCount * 2;
-			frame = 0;
+			frame = firstPts;
+			lastPts = Int64::MinValue;
 			// int stride = Width * 3;
 			int fps = 1;
 
-			int colorSpace = X264_CSP_I420;
+			// NV12 is x264's internal layout, so it takes the picture without repacking the chroma.
+			interleavedChroma = Options->PictureFormat == X264PictureFormat::NV12;
+			int colorSpace = interleavedChroma ? X264_CSP_NV12 : X264_CSP_I420;
 			//if (Options->Colorspace == X264Colorspace::I420)
 			//	colorSpace = X264_CSP_I420;
 			//else if (Options->Colorspace == X264Colorspace::I422)
@@ -38,10 +89,10 @@ namespace x264net
 			//else if (Options->Colorspace == X264Colorspace::I444)
 			//	colorSpace = X264_CSP_I444;
 
-			pic_in = new x264_picture_t();
-			int success = x264_picture_alloc(pic_in, colorSpace, Options->Width, Options->Height);
-			if (success != 0)
-				throw gcnew Exception("x264_picture_alloc failed with code " + success);
+			// Gray input never has color, so its chroma planes are filled once when the pictures are allocated and left alone.
+			grayscaleInput = Options->InputFormat == X264PixelFormat::Gray8;
+			picturePool = new PicturePool();
+			AllocateInputs();
 
 			pic_out = new x264_picture_t();
 
@@ -53,8 +104,57 @@ namespace x264net
 			param->i_threads = Options->Threads;
 			param->i_width = Options->Width;
 			param->i_height = Options->Height;
+			if (Options->FPS < 1 || Options->FPSDenominator < 1)
+				throw gcnew Exception("FPS and FPSDenominator must be at least 1. Provided values: " + Options->FPS + " / " + Options->FPSDenominator);
 			param->i_fps_num = Options->FPS; // Frame rate has some effect on image quality ...
-			param->i_fps_den = 1;
+			param->i_fps_den = Options->FPSDenominator;
+
+			// Timestamps: by default one unit per frame.  With an explicit timebase, rate control follows the caller's timestamps.
+			frameDuration = 1;
+			if (Options->TimebaseNumerator != 0 || Options->TimebaseDenominator != 0)
+			{
+				if (Options->TimebaseNumerator < 1 || Options->TimebaseDenominator < 1)
+					throw gcnew Exception("TimebaseNumerator and TimebaseDenominator must both be at least 1, or both be 0. Provided values: " + Options->TimebaseNumerator + " / " + Options->TimebaseDenominator);
+				param->b_vfr_input = 1;
+				param->i_timebase_num = Options->TimebaseNumerator;
+				param->i_timebase_den = Options->TimebaseDenominator;
+				// The nominal frame interval in timebase units, used when the caller does not supply a timestamp.
+				frameDuration = Math::Max((int64_t)1, (int64_t)Math::Round((double)Options->TimebaseDenominator * Options->FPSDenominator / ((double)Options->TimebaseNumerator * Options->FPS)));
+				frame = firstPts * frameDuration;
+			}
+
+			// Color: convert with the requested matrix and range, and tell the decoder which ones we used.
+			convertRgb = GetRgbToYuv420((YuvMatrix)(int)Options->ColorMatrix, Options->FullRange, (PixelLayout)(int)Options->InputFormat, interleavedChroma);
+			if (Options->InputFormat == X264PixelFormat::Gray8 || Options->DetectGrayscale)
+			{
+				grayToLuma = new uint8_t[256];
+				BuildGrayToLuma((YuvMatrix)(int)Options->ColorMatrix, Options->FullRange, grayToLuma);
+				if (Options->InputFormat == X264PixelFormat::Gray8)
+					convertGray = &GrayToLuma<1>;
+				else if (Options->InputFormat == X264PixelFormat::BGRA32)
+					convertGray = &GrayToLuma<4>;
+				else
+					convertGray = &GrayToLuma<3>;
+			}
+			param->vui.b_fullrange = Options->FullRange ? 1 : 0;
+			if (Options->ColorMatrix == X264ColorMatrix::BT709)
+			{
+				param->vui.i_colorprim = 1; // bt709
+				param->vui.i_transfer = 1; // bt709
+				param->vui.i_colmatrix = 1; // bt709
+			}
+			else if (Options->ColorMatrix == X264ColorMatrix::BT2020)
+			{
+				param->vui.i_colorprim = 9; // bt2020
+				param->vui.i_transfer = 14; // bt2020-10
+				param->vui.i_colmatrix = 9; // bt2020nc
+			}
+			else
+			{
+				param->vui.i_colorprim = 6; // smpte170m
+				param->vui.i_transfer = 6; // smpte170m
+				param->vui.i_colmatrix = 6; // smpte170m
+			}
 
 			// Intra refresh:
 			param->i_keyint_max = Options->IframeInterval;
@@ -68,7 +168,25 @@ namespace x264net
 			if (Options->BitRateSmoothOverSeconds > 10)
 				Options->BitRateSmoothOverSeconds = 10;
 			param->rc.i_vbv_buffer_size = (int)(Options->MaxBitRate * Options->BitRateSmoothOverSeconds);
-			if (Options->ConstantBitRate)
+			if (Options->Pass > 0)
+			{
+				// Multi-pass encoding is bit rate targeted by definition.
+				if (Options->Pass > 3)
+					throw gcnew Exception("Pass must be 0, 1, 2, or 3. Provided value: " + Options->Pass);
+				if (Options->AverageBitRate <= 0)
+					throw gcnew Exception("No AverageBitRate value was specified when using multi-pass encoding");
+				if (String::IsNullOrEmpty(Options->StatsFile))
+					throw gcnew Exception("No StatsFile was specified when using multi-pass encoding");
+				param->rc.i_rc_method = X264_RC_ABR;
+				param->rc.i_bitrate = Options->AverageBitRate;
+				// x264 keeps using these strings until the encoder is closed.
+				statsFile = _strdup(getStdString(Options->StatsFile).c_str());
+				param->rc.b_stat_write = Options->Pass == 1 || Options->Pass == 3 ? 1 : 0;
+				param->rc.psz_stat_out = statsFile;
+				param->rc.b_stat_read = Options->Pass >= 2 ? 1 : 0;
+				param->rc.psz_stat_in = statsFile;
+			}
+			else if (Options->ConstantBitRate)
 			{
 				param->rc.i_rc_method = X264_RC_ABR;
 				if (Options->MaxBitRate > 0)
@@ -84,15 +202,72 @@ namespace x264net
 					param->rc.f_rf_constant_max = Options->QualityMinimum;
 			}
 
+			// Duplicate frames:
+			if (Options->DuplicateFrames == X264DuplicateFrameMode::Skip)
+			{
+				// Dropped frames leave gaps in the timestamps, which rate control must account for.
+				param->b_vfr_input = 1;
+			}
+			else if (Options->DuplicateFrames == X264DuplicateFrameMode::EncodeAsSkip)
+			{
+				param->analyse.b_mb_info = 1;
+				int mbCount = ((Options->Width + 15) / 16) * ((Options->Height + 15) / 16);
+				constantMbInfo = new uint8_t[mbCount];
+				memset(constantMbInfo, X264_MBINFO_CONSTANT, mbCount);
+			}
+
+			// Grayscale input: chroma is flat, so motion search need not look at it.
+			if (Options->InputFormat == X264PixelFormat::Gray8)
+				param->analyse.b_chroma_me = 0;
+
 			//For streaming:
 			param->b_repeat_headers = 1;
 			param->b_annexb = 1;
+			param->b_stitchable = stitchable ? 1 : 0;
+
+			// Disable options that are not useful on a first pass (e.g. fewer reference frames, faster subpixel refinement).
+			if (Options->Pass == 1)
+				x264_param_apply_fastfirstpass(param);
+
+			// Raw parameter overrides win over everything above, but not over the profile.
+			ApplyParamOverrides();
 
 			// Enforce baseline profile
 			x264_param_apply_profile(param, getStdString(Options->Profile.ToString()).c_str());
 
 			// Open Encoder
 			encoder = x264_encoder_open(param);
+			if (!encoder)
+				throw gcnew Exception("x264_encoder_open failed. Check that the options are valid" + (Options->Pass >= 2 ? " and that StatsFile was written by a previous pass with the same options." : "."));
+
+			bufferPool = new EncodedBufferPool();
+			recordPool = new FrameRecordPool();
+			pendingSei = new std::vector<x264_sei_payload_t>();
+			if (Options->EnableTracing)
+			{
+				traceRing = new TraceRing(Options->TraceCapacity);
+				traceGcCount = GC::CollectionCount(0);
+			}
+
+			if (Options->AdaptiveSpeed)
+			{
+				if (Options->AdaptiveSpeedTargetLoad <= 0)
+					throw gcnew Exception("AdaptiveSpeedTargetLoad must be greater than 0");
+				// Start from the parameters as validated by the encoder, so that every level is a subset of what it really uses.
+				x264_param_t opened;
+				x264_encoder_parameters(encoder, &opened);
+				speedControl = new SpeedControl(opened, Options->AdaptiveSpeedTargetLoad * Options->FPSDenominator / Options->FPS);
+			}
+
+			if (Options->EnableGopCache)
+			{
+				gopCache = new GopCache(Options->GopCacheMaxFrames > 0 ? Options->GopCacheMaxFrames : Options->IframeInterval);
+				x264_nal_t* headerNals;
+				int i_headerNals;
+				int headerSize = x264_encoder_headers(encoder, &headerNals, &i_headerNals);
+				if (headerSize > 0)
+					gopCache->SetHeaders(headerNals[0].p_payload, headerSize);
+			}
 		}
 		catch (Exception^)
 		{
@@ -107,35 +282,122 @@ namespace x264net
 			throw gcnew Exception("Unknown exception caught");
 		}
 	}
+	/// <summary>
+	/// <para>Takes the input picture (and the spare one, with OverlapConversion) for the current size from the picture pool.</para>
+	/// </summary>
+	void X264Net::AllocateInputs()
+	{
+		int colorSpace = interleavedChroma ? X264_CSP_NV12 : X264_CSP_I420;
+		pic_in = picturePool->Acquire(colorSpace, Options->Width, Options->Height);
+		if (!pic_in)
+			throw gcnew OutOfMemoryException("Unable to allocate a " + Options->Width + " x " + Options->Height + " input picture");
+		chromaNeutral = false;
+		if (grayscaleInput)
+		{
+			FillNeutralChroma(Options->Width, Options->Height, pic_in->img.plane[1], pic_in->img.i_stride[1], pic_in->img.plane[2], pic_in->img.i_stride[2], interleavedChroma);
+			chromaNeutral = true;
+		}
+		// With OverlapConversion, x264 encodes one picture while the next frame is converted into the other.
+		if (Options->OverlapConversion)
+		{
+			spareInput = picturePool->Acquire(colorSpace, Options->Width, Options->Height);
+			if (!spareInput)
+				throw gcnew OutOfMemoryException("Unable to allocate a " + Options->Width + " x " + Options->Height + " input picture");
+			spareChromaNeutral = false;
+			if (grayscaleInput)
+			{
+				FillNeutralChroma(Options->Width, Options->Height, spareInput->img.plane[1], spareInput->img.i_stride[1], spareInput->img.plane[2], spareInput->img.i_stride[2], interleavedChroma);
+				spareChromaNeutral = true;
+			}
+		}
+	}
+	void X264Net::ReleaseInputs()
+	{
+		picturePool->Release(pic_in);
+		pic_in = NULL;
+		picturePool->Release(spareInput);
+		spareInput = NULL;
+	}
 	X264Net::~X264Net()
 	{
 		// This method appears as "Dispose()" in C#.
-		// We would dispose of managed data here, if we had any that needed disposing.
-		this->!X264Net();
+		// A frame still encoding in the background must finish before the encoder is closed.
+		if (pendingEncode != nullptr)
+		{
+			try
+			{
+				pendingEncode->Wait();
+			}
+			catch (Exception^)
+			{
+			}
+			pendingEncode = nullptr;
+		}
+		MultiplexMember^ member = multiplexMember;
+		if (member != nullptr)
+			member->multiplexer->Leave(this);
+		DisposeLocked();
 	}
-	X264Net::!X264Net()
+	/// <summary>
+	/// <para>Frees the native state once no JoinSnapshot or ExportTrace call is reading it.</para>
+	/// </summary>
+	void X264Net::DisposeLocked()
 	{
-		if (isDisposed)
-			return;
-
-		// This is the Finalizer, for disposing of unmanaged data.  Managed data should not be disposed here, because managed classes may have already been garbage collected by the time this runs.
+		System::Threading::Monitor::Enter(disposeLock);
 		try
 		{
-			x264_encoder_close(encoder);
+			this->!X264Net();
 		}
-		catch (...)
+		finally
 		{
+			System::Threading::Monitor::Exit(disposeLock);
 		}
+	}
+	X264Net::!X264Net()
+	{
+		if (isDisposed)
+			return;
+
+		// This is the Finalizer, for disposing of unmanaged data.  Managed data should not be disposed here, because managed classes may have already been garbage collected by the time this runs.
 		try
 		{
-			x264_picture_clean(pic_in);
+			if (encoder)
+				x264_encoder_close(encoder);
 		}
 		catch (...)
 		{
 		}
+		// x264 finishes writing the multi-pass stats file in x264_encoder_close, so this must be freed afterward.
+		free(statsFile);
+		statsFile = NULL;
+		if (picturePool)
+			ReleaseInputs();
+		delete picturePool;
+		picturePool = NULL;
+		delete gopCache;
+		gopCache = NULL;
+		delete speedControl;
+		speedControl = NULL;
+		delete[] constantMbInfo;
+		constantMbInfo = NULL;
+		delete[] grayToLuma;
+		grayToLuma = NULL;
+		delete recordPool;
+		recordPool = NULL;
+		delete traceRing;
+		traceRing = NULL;
+		if (pendingSei)
+			ReleasePendingSei();
+		delete pendingSei;
+		pendingSei = NULL;
+		if (broadcastRing)
+			broadcastRing->Release();
+		broadcastRing = NULL;
+		if (bufferPool)
+			bufferPool->Release();
+		bufferPool = NULL;
 		delete param;
 		// delete encoder; // Apparently we shouldn't try to delete this pointer because we didn't use "new"
-		delete pic_in;
 		delete pic_out;
 
 		isDisposed = true;
@@ -143,68 +405,1071 @@ namespace x264net
 	/// <summary>
 	/// <para>Encodes a frame, returning an array of H.264 NAL units which are the encoded form of the frame.</para>
 	/// </summary>
-	/// <param name="rgb_data">A byte array containing raw RGB data (3 bytes / 24 bits per pixel).  This array's length must be equal to Width * Height * 3.</param>
+	/// <param name="rgb_data">A byte array containing raw image data in Options.InputFormat (by default RGB, 3 bytes / 24 bits per pixel).  This array's length must be equal to Width * Height * the bytes per pixel of the format, or cover Height rows of InputStride bytes if rows are padded.</param>
 	array<array<Byte>^>^ X264Net::EncodeFrame(array<Byte>^ rgb_data)
 	{
-		return (array<array<Byte>^>^)EncodeFrame_Internal(rgb_data, true);
+		return (array<array<Byte>^>^)EncodeFrame_Internal(rgb_data, frame, 0, EncodeOutput::NalArrays);
+	}
+	/// <summary>
+	/// <para>Encodes a frame captured at the specified time, returning an array of H.264 NAL units which are the encoded form of the frame.</para>
+	/// </summary>
+	/// <param name="rgb_data">A byte array containing raw image data in Options.InputFormat (by default RGB, 3 bytes / 24 bits per pixel).  This array's length must be equal to Width * Height * the bytes per pixel of the format, or cover Height rows of InputStride bytes if rows are padded.</param>
+	/// <param name="timestamp">The presentation time of the frame, in units of the timebase (see X264Options.TimebaseNumerator).  Must be greater than the timestamp of the previous frame.</param>
+	array<array<Byte>^>^ X264Net::EncodeFrame(array<Byte>^ rgb_data, Int64 timestamp)
+	{
+		return (array<array<Byte>^>^)EncodeFrame_Internal(rgb_data, timestamp, 0, EncodeOutput::NalArrays);
 	}
 	/// <summary>
 	/// <para>Encodes a frame, returning a single byte array containing one or more H.264 NAL units which are the encoded form of the frame.</para>
 	/// </summary>
-	/// <param name="rgb_data">A byte array containing raw RGB data (3 bytes / 24 bits per pixel).  This array's length must be equal to Width * Height * 3.</param>
+	/// <param name="rgb_data">A byte array containing raw image data in Options.InputFormat (by default RGB, 3 bytes / 24 bits per pixel).  This array's length must be equal to Width * Height * the bytes per pixel of the format, or cover Height rows of InputStride bytes if rows are padded.</param>
 	array<Byte>^ X264Net::EncodeFrameAsWholeArray(array<Byte>^ rgb_data)
 	{
-		return (array<Byte>^)EncodeFrame_Internal(rgb_data, false);
+		return (array<Byte>^)EncodeFrame_Internal(rgb_data, frame, 0, EncodeOutput::WholeArray);
+	}
+	/// <summary>
+	/// <para>Encodes a frame captured at the specified time, returning a single byte array containing one or more H.264 NAL units which are the encoded form of the frame.</para>
+	/// </summary>
+	/// <param name="rgb_data">A byte array containing raw image data in Options.InputFormat (by default RGB, 3 bytes / 24 bits per pixel).  This array's length must be equal to Width * Height * the bytes per pixel of the format, or cover Height rows of InputStride bytes if rows are padded.</param>
+	/// <param name="timestamp">The presentation time of the frame, in units of the timebase (see X264Options.TimebaseNumerator).  Must be greater than the timestamp of the previous frame.</param>
+	array<Byte>^ X264Net::EncodeFrameAsWholeArray(array<Byte>^ rgb_data, Int64 timestamp)
+	{
+		return (array<Byte>^)EncodeFrame_Internal(rgb_data, timestamp, 0, EncodeOutput::WholeArray);
+	}
+	/// <summary>
+	/// <para>Encodes a frame read directly from native memory (e.g. a locked Bitmap, a DIB section, or a capture driver's buffer), returning a single byte array containing one or more H.264 NAL units.  InputStride and InputBottomUp are ignored; the stride says how the rows are laid out.</para>
+	/// </summary>
+	/// <param name="data">A pointer to the top row of the frame, in Options.InputFormat.</param>
+	/// <param name="stride">The distance in bytes from the start of one row to the start of the row below it.  Negative for bottom-up images, as in BitmapData.Stride.</param>
+	array<Byte>^ X264Net::EncodeFrameAsWholeArray(IntPtr data, int stride)
+	{
+		return EncodeFrameAsWholeArray(data, stride, frame);
+	}
+	/// <summary>
+	/// <para>Encodes a frame read directly from native memory, captured at the specified time, returning a single byte array containing one or more H.264 NAL units.  See the other overload.</para>
+	/// </summary>
+	/// <param name="data">A pointer to the top row of the frame, in Options.InputFormat.</param>
+	/// <param name="stride">The distance in bytes from the start of one row to the start of the row below it.  Negative for bottom-up images, as in BitmapData.Stride.</param>
+	/// <param name="timestamp">The presentation time of the frame, in units of the timebase (see X264Options.TimebaseNumerator).  Must be greater than the timestamp of the previous frame.</param>
+	array<Byte>^ X264Net::EncodeFrameAsWholeArray(IntPtr data, int stride, Int64 timestamp)
+	{
+		if (data == IntPtr::Zero)
+			throw gcnew ArgumentNullException("data");
+		int rowBytes = Options->Width * X264Options::BytesPerPixel(Options->InputFormat);
+		if (Math::Abs(stride) < rowBytes)
+			throw gcnew ArgumentException("The stride must be at least Width * bytes per pixel (" + rowBytes + ") in either direction. Provided value: " + stride, "stride");
+		return (array<Byte>^)EncodeImage((const uint8_t*)data.ToPointer(), stride, timestamp, 0, EncodeOutput::WholeArray);
+	}
+	/// <summary>
+	/// <para>Encodes a frame and publishes it to the attached FrameBroadcaster (and GOP cache, if enabled) without copying the output into managed memory.</para>
+	/// </summary>
+	/// <param name="rgb_data">A byte array containing raw image data in Options.InputFormat (by default RGB, 3 bytes / 24 bits per pixel).  This array's length must be equal to Width * Height * the bytes per pixel of the format, or cover Height rows of InputStride bytes if rows are padded.</param>
+	void X264Net::PublishFrame(array<Byte>^ rgb_data)
+	{
+		EncodeFrame_Internal(rgb_data, frame, 0, EncodeOutput::None);
+	}
+	/// <summary>
+	/// <para>Encodes a frame captured at the specified time and publishes it to the attached FrameBroadcaster (and GOP cache, if enabled) without copying the output into managed memory.</para>
+	/// </summary>
+	/// <param name="rgb_data">A byte array containing raw image data in Options.InputFormat (by default RGB, 3 bytes / 24 bits per pixel).  This array's length must be equal to Width * Height * the bytes per pixel of the format, or cover Height rows of InputStride bytes if rows are padded.</param>
+	/// <param name="timestamp">The presentation time of the frame, in units of the timebase (see X264Options.TimebaseNumerator).  Must be greater than the timestamp of the previous frame.</param>
+	void X264Net::PublishFrame(array<Byte>^ rgb_data, Int64 timestamp)
+	{
+		EncodeFrame_Internal(rgb_data, timestamp, 0, EncodeOutput::None);
+	}
+	/// <summary>
+	/// <para>Encodes a frame tagged with a caller-defined token, returning the frame x264 output during this call (which, if x264 delays frames, belongs to an earlier submission) along with its token, timestamps, and timing.  Returns null if x264 produced no output during this call.</para>
+	/// </summary>
+	/// <param name="rgb_data">A byte array containing raw image data in Options.InputFormat (by default RGB, 3 bytes / 24 bits per pixel).  This array's length must be equal to Width * Height * the bytes per pixel of the format, or cover Height rows of InputStride bytes if rows are padded.</param>
+	/// <param name="token">Any value, such as a sequence number or capture time, returned in EncodedFrameInfo.Token with this frame's output.</param>
+	EncodedFrameInfo^ X264Net::EncodeFrameTracked(array<Byte>^ rgb_data, Int64 token)
+	{
+		return (EncodedFrameInfo^)EncodeFrame_Internal(rgb_data, frame, token, EncodeOutput::Tracked);
+	}
+	/// <summary>
+	/// <para>Encodes a frame captured at the specified time and tagged with a caller-defined token, returning the frame x264 output during this call (which, if x264 delays frames, belongs to an earlier submission) along with its token, timestamps, and timing.  Returns null if x264 produced no output during this call.</para>
+	/// </summary>
+	/// <param name="rgb_data">A byte array containing raw image data in Options.InputFormat (by default RGB, 3 bytes / 24 bits per pixel).  This array's length must be equal to Width * Height * the bytes per pixel of the format, or cover Height rows of InputStride bytes if rows are padded.</param>
+	/// <param name="timestamp">The presentation time of the frame, in units of the timebase (see X264Options.TimebaseNumerator).  Must be greater than the timestamp of the previous frame.</param>
+	/// <param name="token">Any value, such as a sequence number or capture time, returned in EncodedFrameInfo.Token with this frame's output.</param>
+	EncodedFrameInfo^ X264Net::EncodeFrameTracked(array<Byte>^ rgb_data, Int64 timestamp, Int64 token)
+	{
+		return (EncodedFrameInfo^)EncodeFrame_Internal(rgb_data, timestamp, token, EncodeOutput::Tracked);
+	}
+	/// <summary>
+	/// <para>Encodes a batch of frames stored back to back in one array, returning the output of all of them in one byte array.  This is much cheaper per frame than calling EncodeFrame for each, which matters for small frames: the input is validated and pinned once, and no managed array is allocated per frame.</para>
+	/// <para>The output of call i (as EncodeFrameAsWholeArray would have returned it) is at [offsets[i], offsets[i + 1]) in the returned array.  offsets has frameCount + 1 entries.</para>
+	/// </summary>
+	/// <param name="frames">The frames, each laid out as for EncodeFrame (Height rows of InputStride bytes, or tightly packed), one after another.</param>
+	/// <param name="frameCount">The number of frames in the array.</param>
+	/// <param name="offsets">Receives the start of each frame's output in the returned array, followed by its total length.</param>
+	array<Byte>^ X264Net::EncodeFrames(array<Byte>^ frames, int frameCount, array<int>^% offsets)
+	{
+		return EncodeFrames(frames, frameCount, nullptr, offsets);
+	}
+	/// <summary>
+	/// <para>Encodes a batch of frames stored back to back in one array, with the specified timestamps, returning the output of all of them in one byte array.  See the other overload.</para>
+	/// </summary>
+	/// <param name="frames">The frames, each laid out as for EncodeFrame (Height rows of InputStride bytes, or tightly packed), one after another.</param>
+	/// <param name="frameCount">The number of frames in the array.</param>
+	/// <param name="timestamps">The presentation time of each frame, in units of the timebase (see X264Options.TimebaseNumerator), or null to number them automatically.</param>
+	/// <param name="offsets">Receives the start of each frame's output in the returned array, followed by its total length.</param>
+	array<Byte>^ X264Net::EncodeFrames(array<Byte>^ frames, int frameCount, array<Int64>^ timestamps, array<int>^% offsets)
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("X264Net");
+		if (frames == nullptr)
+			throw gcnew ArgumentNullException("frames");
+		if (frameCount < 0)
+			throw gcnew ArgumentOutOfRangeException("frameCount");
+		if (timestamps != nullptr)
+		{
+			if (timestamps->Length < frameCount)
+				throw gcnew ArgumentException("Only " + timestamps->Length + " timestamps were provided for " + frameCount + " frames", "timestamps");
+			// Check every timestamp now, so a bad one cannot leave the batch half encoded.
+			int64_t previous = lastPts;
+			for (int i = 0; i < frameCount; i++)
+			{
+				if (timestamps[i] <= previous)
+					throw gcnew ArgumentException("Frame timestamps must increase. Timestamp " + i + " (" + timestamps[i] + ") is not greater than the previous timestamp " + previous, "timestamps");
+				previous = timestamps[i];
+			}
+		}
+		int stride = Options->InputRowStride();
+		int64_t frameBytes = (int64_t)stride * Options->Height;
+		if (frames->Length < frameBytes * frameCount)
+			throw gcnew ArgumentException("Input image data has size " + frames->Length + " but " + frameCount + " frames of " + frameBytes + " bytes need " + (frameBytes * frameCount), "frames");
+
+		std::vector<uint8_t> appended;
+		std::vector<int> ends;
+		ends.reserve(frameCount);
+		if (frameCount > 0)
+		{
+			pin_ptr<Byte> pinned_frames = &frames[0];
+			const uint8_t* first = pinned_frames;
+			int topRow = Options->InputBottomUp ? stride * (Options->Height - 1) : 0;
+			int rowStep = Options->InputBottomUp ? -stride : stride;
+			appendTarget = &appended;
+			try
+			{
+				for (int i = 0; i < frameCount; i++)
+				{
+					EncodeImage(first + frameBytes * i + topRow, rowStep, timestamps != nullptr ? timestamps[i] : frame, 0, EncodeOutput::Append);
+					ends.push_back((int)appended.size());
+				}
+			}
+			finally
+			{
+				appendTarget = NULL;
+			}
+		}
+		return TakeAppended(appended, ends, offsets);
+	}
+	/// <summary>
+	/// <para>Encodes one frame on each of several encoders (e.g. the next frame of many thumbnail streams), returning all of the output in one byte array.  frames[i] is encoded by encoders[i]; an encoder may appear more than once, and its frames are encoded in order.</para>
+	/// <para>The output of pair i is at [offsets[i], offsets[i + 1]) in the returned array.  offsets has one more entry than there are pairs.</para>
+	/// </summary>
+	/// <param name="encoders">The encoder for each frame.</param>
+	/// <param name="frames">The frames, each laid out as for EncodeFrame on its encoder.</param>
+	/// <param name="offsets">Receives the start of each frame's output in the returned array, followed by its total length.</param>
+	array<Byte>^ X264Net::EncodeFrames(array<X264Net^>^ encoders, array<array<Byte>^>^ frames, array<int>^% offsets)
+	{
+		if (encoders == nullptr)
+			throw gcnew ArgumentNullException("encoders");
+		if (frames == nullptr)
+			throw gcnew ArgumentNullException("frames");
+		if (encoders->Length != frames->Length)
+			throw gcnew ArgumentException("There are " + encoders->Length + " encoders but " + frames->Length + " frames. Each frame needs one encoder.", "frames");
+		// Check every pair now, so a bad one cannot leave the batch half encoded.
+		for (int i = 0; i < frames->Length; i++)
+		{
+			if (encoders[i] == nullptr)
+				throw gcnew ArgumentNullException("encoders", "Encoder " + i + " is null.");
+			if (encoders[i]->isDisposed)
+				throw gcnew ObjectDisposedException("X264Net");
+			if (frames[i] == nullptr)
+				throw gcnew ArgumentNullException("frames", "Frame " + i + " is null.");
+			int topRow;
+			encoders[i]->Options->LocateInputRows(frames[i], topRow);
+		}
+		std::vector<uint8_t> appended;
+		std::vector<int> ends;
+		ends.reserve(frames->Length);
+		for (int i = 0; i < frames->Length; i++)
+		{
+			X264Net^ encoder = encoders[i];
+			encoder->appendTarget = &appended;
+			try
+			{
+				encoder->EncodeFrame_Internal(frames[i], encoder->frame, 0, EncodeOutput::Append);
+			}
+			finally
+			{
+				encoder->appendTarget = NULL;
+			}
+			ends.push_back((int)appended.size());
+		}
+		return TakeAppended(appended, ends, offsets);
+	}
+	/// <summary>
+	/// <para>Copies the output of a batch into one managed array, and builds its offsets table from the end of each frame's output.</para>
+	/// </summary>
+	array<Byte>^ X264Net::TakeAppended(std::vector<uint8_t>& appended, std::vector<int>& ends, array<int>^% offsets)
+	{
+		offsets = gcnew array<int>((int)ends.size() + 1);
+		offsets[0] = 0;
+		for (size_t i = 0; i < ends.size(); i++)
+			offsets[(int)i + 1] = ends[i];
+		array<Byte>^ data = gcnew array<Byte>((int)appended.size());
+		if (!appended.empty())
+			System::Runtime::InteropServices::Marshal::Copy((IntPtr)appended.data(), data, 0, (int)appended.size());
+		return data;
 	}
-	Object^ X264Net::EncodeFrame_Internal(array<Byte>^ rgb_data, bool eachNalGetsOwnArray)
+	Object^ X264Net::EncodeFrame_Internal(array<Byte>^ rgb_data, int64_t pts, int64_t token, EncodeOutput output)
 	{
-		if (rgb_data->Length != Options->Width * Options->Height * 3)
-			throw gcnew ArgumentException("Input image data has size " + rgb_data->Length + " but the expected size is " + (Options->Width * Options->Height * 3) + " (" + Options->Width + " * " + Options->Height + " * 3)", "rgb_data");
+		int topRow;
+		int stride = Options->LocateInputRows(rgb_data, topRow);
 
-		// increment presentation timestamp; just because.
-		pic_in->i_pts = frame++;
+		// When pinned_rgb_data goes out of scope, the managed array is unpinned.
+		pin_ptr<Byte> pinned_rgb_data = &rgb_data[0];
+		const uint8_t* data = pinned_rgb_data;
+		return EncodeImage(data + topRow, stride, pts, token, output);
+	}
+	/// <summary>
+	/// <para>Encodes an image of Options->Width x Options->Height pixels in Options->InputFormat whose rows start rgbStride bytes apart (going up if rgbStride is negative).  Used directly by TiledEncoder to encode a region of a larger image without copying it.</para>
+	/// </summary>
+	Object^ X264Net::EncodeImage(const uint8_t* rgb, int rgbStride, int64_t pts, int64_t token, EncodeOutput output)
+	{
+		int64_t startTime = BeginFrame(pts);
 
-		// Convert RGB in pinned_rgb_data to YUV420P (a.k.a. YUV420 / I420) in pic_in
+		bool duplicate = false;
+		if (Options->DuplicateFrames != X264DuplicateFrameMode::Off)
 		{
-			// When pinned_rgb_data goes out of scope, the managed array is unpinned.
-			pin_ptr<Byte> pinned_rgb_data = &rgb_data[0];
-			Bitmap2Yuv420p_calc2(pic_in->img.plane[0], pinned_rgb_data, Options->Width, Options->Height);
+			int64_t hashStart = traceRing ? System::Diagnostics::Stopwatch::GetTimestamp() : 0;
+			// A frame whose overlays changed (e.g. a ticking timestamp) is not a duplicate even if its input is.
+			uint64_t hash = HashImage(rgb, rgbStride, Options->Width * X264Options::BytesPerPixel(Options->InputFormat), Options->Height) ^ OverlayState();
+			duplicate = hasPreviousFrame && hash == previousHash;
+			previousHash = hash;
+			hasPreviousFrame = true;
+			if (traceRing)
+				Trace(TraceStageHash, hashStart);
 		}
+		if (duplicate)
+		{
+			duplicateFrameCount++;
+			if (Options->DuplicateFrames == X264DuplicateFrameMode::Skip)
+			{
+				if (traceRing)
+					TraceFrame(startTime);
+				return TakeOutput(NULL, NULL, 0, output);
+			}
+			// pic_in still holds the previous frame's YUV, overlays included (with OverlapConversion, the other picture does).  Every macroblock is flagged unchanged so x264 can skip them.
+			if (spareInput)
+				ReuseSubmittedInput();
+			pic_in->prop.mb_info = constantMbInfo;
+		}
+		else
+		{
+			pic_in->prop.mb_info = NULL;
+			// Convert RGB to YUV 4:2:0 (I420, or NV12 if interleavedChroma) in pic_in
+			int64_t convertStart = traceRing ? System::Diagnostics::Stopwatch::GetTimestamp() : 0;
+			// Gray8 input is always gray, and has no color path to fall back to.
+			if (Options->DetectGrayscale && Options->InputFormat != X264PixelFormat::Gray8)
+			{
+				bool gray = IsGrayRgb(rgb, rgbStride, Options->Width, Options->Height, X264Options::BytesPerPixel(Options->InputFormat));
+				if (gray != grayscaleInput)
+					SetGrayscaleInput(gray);
+			}
+			if (grayscaleInput)
+			{
+				// Luma only.  Chroma is already 128 unless color was drawn into it since.
+				convertGray(rgb, rgbStride, Options->Width, Options->Height, grayToLuma, pic_in->img.plane[0], pic_in->img.i_stride[0]);
+				if (!chromaNeutral)
+				{
+					FillNeutralChroma(Options->Width, Options->Height, pic_in->img.plane[1], pic_in->img.i_stride[1], pic_in->img.plane[2], pic_in->img.i_stride[2], interleavedChroma);
+					chromaNeutral = true;
+				}
+			}
+			else
+			{
+				convertRgb(rgb, rgbStride, Options->Width, Options->Height,
+					pic_in->img.plane[0], pic_in->img.i_stride[0],
+					pic_in->img.plane[1], pic_in->img.i_stride[1],
+					pic_in->img.plane[2], pic_in->img.i_stride[2]);
+				chromaNeutral = false;
+			}
+			if (Overlays != nullptr && Overlays->Count != 0)
+			{
+				BlendOverlays();
+				chromaNeutral = false;
+			}
+			if (traceRing)
+				Trace(TraceStageConvert, convertStart);
+		}
+		return FinishFrame(startTime, token, output);
+	}
+	/// <summary>
+	/// <para>Switches between color and grayscale encoding when DetectGrayscale sees the input change.  Chroma motion estimation is turned off while the input is gray, unless it was never on.</para>
+	/// </summary>
+	void X264Net::SetGrayscaleInput(bool gray)
+	{
+		grayscaleInput = gray;
+		if (!param->analyse.b_chroma_me)
+			return;
+		JoinPendingEncode();
+		x264_param_t current;
+		x264_encoder_parameters(encoder, &current);
+		current.analyse.b_chroma_me = gray ? 0 : 1;
+		int result = x264_encoder_reconfig(encoder, &current);
+		if (result < 0)
+			throw gcnew Exception("x264_encoder_reconfig failed with return value " + result);
+	}
+	/// <summary>
+	/// <para>Identifies the current appearance of all overlays, for duplicate frame detection.</para>
+	/// </summary>
+	uint64_t X264Net::OverlayState()
+	{
+		uint64_t state = 0;
+		if (Overlays == nullptr)
+			return state;
+		for (int i = 0; i < Overlays->Count; i++)
+		{
+			if (Overlays[i] != nullptr)
+				state = (state + (uint64_t)Overlays[i]->Version) * 0x9E3779B97F4A7C15ULL;
+		}
+		return state;
+	}
+	/// <summary>
+	/// <para>Draws the overlays into pic_in, in list order.</para>
+	/// </summary>
+	void X264Net::BlendOverlays()
+	{
+		YuvMatrix matrix = (YuvMatrix)(int)Options->ColorMatrix;
+		for (int i = 0; i < Overlays->Count; i++)
+		{
+			if (Overlays[i] != nullptr)
+				Overlays[i]->Blend(pic_in->img.plane, pic_in->img.i_stride, Options->Width, Options->Height, matrix, Options->FullRange, interleavedChroma);
+		}
+	}
+	/// <summary>
+	/// <para>Encodes pic_in as it is, without converting anything into it.  Used by MosaicEncoder, which renders its inputs directly into the picture returned by InputPicture.</para>
+	/// </summary>
+	Object^ X264Net::EncodeInputPicture(int64_t pts, int64_t token, EncodeOutput output)
+	{
+		int64_t startTime = BeginFrame(pts);
+		pic_in->prop.mb_info = NULL;
+		return FinishFrame(startTime, token, output);
+	}
+	/// <summary>
+	/// <para>Validates and assigns the timestamp of the frame about to be encoded.  Returns the time the frame was submitted.</para>
+	/// </summary>
+	int64_t X264Net::BeginFrame(int64_t pts)
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("X264Net");
+
+		int64_t startTime = System::Diagnostics::Stopwatch::GetTimestamp();
+
+		if (pts <= lastPts)
+			throw gcnew ArgumentException("Frame timestamps must increase. Provided timestamp " + pts + " is not greater than the previous timestamp " + lastPts, "timestamp");
+		pic_in->i_pts = pts;
+		lastPts = pts;
+		frame = pts + frameDuration;
+		tracePts = pts;
+		return startTime;
+	}
+	/// <summary>
+	/// <para>Encodes pic_in once its content is ready, and returns the output in the requested form.</para>
+	/// </summary>
+	Object^ X264Net::FinishFrame(int64_t startTime, int64_t token, EncodeOutput output)
+	{
+		// Encode frame.  The record travels through x264 with the picture and comes back with its output.
+		FrameRecord* record = recordPool->Acquire();
+		record->token = token;
+		record->submitted = startTime;
+		pic_in->opaque = record;
+		AttachPendingSei();
+		if (spareInput)
+			return FinishFrameOverlapped(startTime, output);
+		x264_nal_t* nals;
+		int i_nals;
+		FrameRecord* outputRecord = SubmitPicture(pic_in, &nals, &i_nals);
 
-		// Encode frame
+		if (speedControl)
+			UpdateSpeedControl((double)(System::Diagnostics::Stopwatch::GetTimestamp() - startTime) / System::Diagnostics::Stopwatch::Frequency);
+		Object^ result = TakeOutput(outputRecord, nals, i_nals, output);
+		if (traceRing)
+			TraceFrame(startTime);
+		return result;
+	}
+	/// <summary>
+	/// <para>Encodes picture, then detaches the SEI messages x264 has taken ownership of.</para>
+	/// </summary>
+	FrameRecord* X264Net::SubmitPicture(x264_picture_t* picture, x264_nal_t** nals, int* i_nals)
+	{
+		try
+		{
+			return EncodePicture(picture, nals, i_nals);
+		}
+		finally
+		{
+			// x264 has taken ownership of the SEI buffers (it copies extra_sei into its own frame), so the picture must not refer to them again.
+			picture->extra_sei.num_payloads = 0;
+			picture->extra_sei.payloads = NULL;
+			picture->extra_sei.sei_free = NULL;
+		}
+	}
+	/// <summary>
+	/// <para>Records how long the last frame took and, if AdaptiveSpeed decides to change level, reconfigures the encoder.  Takes effect from the next frame; output already returned by x264 is not affected.</para>
+	/// </summary>
+	void X264Net::UpdateSpeedControl(double seconds)
+	{
+		x264_param_t tuned;
+		if (!speedControl->Update(seconds, &tuned))
+			return;
+		int64_t reconfigStart = traceRing ? System::Diagnostics::Stopwatch::GetTimestamp() : 0;
+		if (grayscaleInput)
+			tuned.analyse.b_chroma_me = 0;
+		// The speed levels were captured with the VBV the encoder opened with; keep the multiplexer's instead.
+		MultiplexMember^ member = multiplexMember;
+		if (member != nullptr)
+			ApplyMultiplexedRate(&tuned, member->applied);
+		int result = x264_encoder_reconfig(encoder, &tuned);
+		if (result < 0)
+			throw gcnew Exception("x264_encoder_reconfig failed with return value " + result);
+		if (traceRing)
+			Trace(TraceStageReconfig, reconfigStart);
+	}
+	/// <summary>
+	/// <para>Reports a frame just output to the BitrateMultiplexer, which may change this encoder's allocation.</para>
+	/// </summary>
+	void X264Net::UpdateMultiplexer(int frameSize)
+	{
+		MultiplexMember^ member = multiplexMember;
+		if (member != nullptr)
+			member->Report(frameSize, pic_out->prop.f_crf_avg);
+	}
+	/// <summary>
+	/// <para>Called before each frame is encoded.  If this encoder's BitrateMultiplexer allocation has dropped or has risen by more than 5% from what its VBV is set to, reconfigures the VBV, so an encoder that just joined is held to its allocation from its first frame.</para>
+	/// </summary>
+	void X264Net::ApplyMultiplexer()
+	{
+		MultiplexMember^ member = multiplexMember;
+		if (member == nullptr)
+			return;
+		int rate = member->allocation;
+		// A lower allocation is applied at once, since other members may already be using what it gave up.  Only increases wait until they are worth a reconfig.
+		if (rate >= member->applied && (rate - member->applied) * 20 <= member->applied)
+			return;
+		int64_t reconfigStart = traceRing ? System::Diagnostics::Stopwatch::GetTimestamp() : 0;
+		x264_param_t current;
+		x264_encoder_parameters(encoder, &current);
+		ApplyMultiplexedRate(&current, rate);
+		int result = x264_encoder_reconfig(encoder, &current);
+		if (result < 0)
+			throw gcnew Exception("x264_encoder_reconfig failed with return value " + result);
+		member->applied = rate;
+		if (traceRing)
+			Trace(TraceStageReconfig, reconfigStart);
+	}
+	/// <summary>
+	/// <para>Sets the VBV (and, for ConstantBitRate, the average bit rate) of a parameter set to a multiplexer allocation in kilobits per second.</para>
+	/// </summary>
+	void X264Net::ApplyMultiplexedRate(x264_param_t* tuned, int rate)
+	{
+		tuned->rc.i_vbv_max_bitrate = rate;
+		tuned->rc.i_vbv_buffer_size = Math::Max(1, (int)(rate * Options->BitRateSmoothOverSeconds));
+		if (tuned->rc.i_rc_method == X264_RC_ABR)
+			tuned->rc.i_bitrate = rate;
+	}
+	/// <summary>
+	/// <para>The OverlapConversion version of FinishFrame.  The previous frame has been encoding in the background while this one was converted; its output is collected and returned, then this frame is handed to the background encode and pic_in switches to the other picture.</para>
+	/// </summary>
+	Object^ X264Net::FinishFrameOverlapped(int64_t startTime, EncodeOutput output)
+	{
+		int64_t convertTicks = System::Diagnostics::Stopwatch::GetTimestamp() - startTime;
+		Object^ result = TakePendingOutput(output);
+		submittedInput = pic_in;
+		pendingStart = startTime;
+		pendingConvertTicks = convertTicks;
+		pendingEncode = System::Threading::Tasks::Task::Factory->StartNew(gcnew Action(this, &X264Net::EncodeSubmitted));
+		SwapInputs();
+		return result;
+	}
+	/// <summary>
+	/// <para>Runs on a thread pool thread when OverlapConversion is enabled: encodes submittedInput while the caller converts the next frame into pic_in.  Nothing else touches the encoder until JoinPendingEncode returns.</para>
+	/// </summary>
+	void X264Net::EncodeSubmitted()
+	{
+		int64_t started = System::Diagnostics::Stopwatch::GetTimestamp();
 		x264_nal_t* nals;
 		int i_nals;
-		int frame_size = x264_encoder_encode(encoder, &nals, &i_nals, pic_in, pic_out);
-		if (frame_size >= 0)
+		pendingRecord = SubmitPicture(submittedInput, &nals, &i_nals);
+		pendingNals = nals;
+		pendingNalCount = i_nals;
+		pendingEncodeTicks = System::Diagnostics::Stopwatch::GetTimestamp() - started;
+	}
+	/// <summary>
+	/// <para>Waits for the background encode, if any, so that the encoder and both input pictures may be used.  Its output stays pending until TakePendingOutput.</para>
+	/// </summary>
+	void X264Net::JoinPendingEncode()
+	{
+		if (pendingEncode == nullptr)
+			return;
+		try
+		{
+			pendingEncode->Wait();
+		}
+		catch (AggregateException^ ex)
+		{
+			pendingEncode = nullptr;
+			throw gcnew Exception("Encoding failed: " + ex->InnerException->Message, ex->InnerException);
+		}
+	}
+	/// <summary>
+	/// <para>Waits for the background encode and returns its output in the requested form, or empty output if nothing was pending.</para>
+	/// </summary>
+	Object^ X264Net::TakePendingOutput(EncodeOutput output)
+	{
+		if (pendingEncode == nullptr)
+			return TakeOutput(NULL, NULL, 0, output);
+		JoinPendingEncode();
+		pendingEncode = nullptr;
+		// The frame took as long as the slower of its two overlapped stages.
+		if (speedControl)
+			UpdateSpeedControl((double)Math::Max(pendingConvertTicks, pendingEncodeTicks) / System::Diagnostics::Stopwatch::Frequency);
+		Object^ result = TakeOutput(pendingRecord, pendingNals, pendingNalCount, output);
+		pendingRecord = NULL;
+		if (traceRing)
+			TraceFrame(pendingStart, submittedInput->i_pts);
+		return result;
+	}
+	/// <summary>
+	/// <para>For a duplicate frame with OverlapConversion: switches pic_in back to the picture submitted last, which holds the previous frame, once x264 is done reading it.</para>
+	/// </summary>
+	void X264Net::ReuseSubmittedInput()
+	{
+		if (submittedInput == NULL)
+			return;
+		JoinPendingEncode();
+		int64_t pts = pic_in->i_pts;
+		SwapInputs();
+		pic_in->i_pts = pts;
+	}
+	void X264Net::SwapInputs()
+	{
+		x264_picture_t* picture = pic_in;
+		pic_in = spareInput;
+		spareInput = picture;
+		bool neutral = chromaNeutral;
+		chromaNeutral = spareChromaNeutral;
+		spareChromaNeutral = neutral;
+	}
+	/// <summary>
+	/// <para>Encodes any frames x264 is still holding back (because of B-frames, lookahead, or frame threads), returning them as a single byte array containing zero or more H.264 NAL units.</para>
+	/// <para>Call this at the end of a stream.  With the default zerolatency tune, x264 holds nothing back and this returns an empty array.</para>
+	/// </summary>
+	array<Byte>^ X264Net::Flush()
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("X264Net");
+		tracePts = -1;
+		System::IO::MemoryStream^ flushed = gcnew System::IO::MemoryStream();
+		array<Byte>^ pending = (array<Byte>^)TakePendingOutput(EncodeOutput::WholeArray);
+		flushed->Write(pending, 0, pending->Length);
+		while (x264_encoder_delayed_frames(encoder) > 0)
+		{
+			x264_nal_t* nals;
+			int i_nals;
+			FrameRecord* record = EncodePicture(NULL, &nals, &i_nals);
+			array<Byte>^ data = (array<Byte>^)TakeOutput(record, nals, i_nals, EncodeOutput::WholeArray);
+			flushed->Write(data, 0, data->Length);
+		}
+		return flushed->ToArray();
+	}
+	/// <summary>
+	/// <para>Like Flush(), but returns each remaining frame separately along with its token, timestamps, and timing.  See EncodeFrameTracked.</para>
+	/// </summary>
+	array<EncodedFrameInfo^>^ X264Net::FlushTracked()
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("X264Net");
+		tracePts = -1;
+		System::Collections::Generic::List<EncodedFrameInfo^>^ flushed = gcnew System::Collections::Generic::List<EncodedFrameInfo^>();
+		EncodedFrameInfo^ pending = (EncodedFrameInfo^)TakePendingOutput(EncodeOutput::Tracked);
+		if (pending != nullptr)
+			flushed->Add(pending);
+		while (x264_encoder_delayed_frames(encoder) > 0)
+		{
+			x264_nal_t* nals;
+			int i_nals;
+			FrameRecord* record = EncodePicture(NULL, &nals, &i_nals);
+			EncodedFrameInfo^ info = (EncodedFrameInfo^)TakeOutput(record, nals, i_nals, EncodeOutput::Tracked);
+			if (info != nullptr)
+				flushed->Add(info);
+		}
+		return flushed->ToArray();
+	}
+	/// <summary>
+	/// <para>Changes the resolution of the stream without creating a new X264Net, e.g. when a captured window is resized or adaptive bit rate logic picks a different rung.  Frames x264 is still holding are encoded at the old size and returned, then x264 is reopened at the new size with the same parameters.  The next frame is an IDR frame carrying the new SPS and PPS, so decoders and FrameBroadcaster viewers switch over cleanly.</para>
+	/// <para>Input pictures come from a pool that keeps the memory of every size used, so switching between a few resolutions allocates nothing after the first switch to each size.  Timestamps, overlays, pending user data, tracing, the output buffer pool, and any attached FrameBroadcaster carry over; the GOP cache starts over and AdaptiveSpeed starts again from the original preset.  Subsequent frames must be in the new size.  Options is replaced with a copy holding the new size; the X264Options object the encoder was created with is not changed.</para>
+	/// <para>Not supported with multi-pass encoding, or on the encoder of a MosaicEncoder.</para>
+	/// </summary>
+	/// <param name="width">The new width of the video, in pixels.  Must be even.</param>
+	/// <param name="height">The new height of the video, in pixels.  Must be even.</param>
+	/// <returns>The output of frames x264 was still holding at the old size, as Flush returns it.</returns>
+	array<Byte>^ X264Net::Resize(int width, int height)
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("X264Net");
+		if (width < 2 || height < 2 || width % 2 != 0 || height % 2 != 0)
+			throw gcnew ArgumentException("Each dimension must be a positive even number. Provided dimensions: " + width + " x " + height);
+		if (Options->Pass > 0)
+			throw gcnew InvalidOperationException("Resize is not supported with multi-pass encoding");
+		if (ownedByMosaic)
+			throw gcnew InvalidOperationException("Resize is not supported on the encoder of a MosaicEncoder, whose regions are laid out for a fixed size");
+		int rowBytes = width * X264Options::BytesPerPixel(Options->InputFormat);
+		if (Options->InputStride != 0 && Options->InputStride < rowBytes)
+			throw gcnew ArgumentException("InputStride (" + Options->InputStride + ") is less than the new Width * bytes per pixel (" + rowBytes + "). Change InputStride first.");
+
+		array<Byte>^ flushed = Flush();
+		if (width == Options->Width && height == Options->Height)
+			return flushed;
+		int oldWidth = Options->Width;
+		int oldHeight = Options->Height;
+		// The caller's options object may be shared with other encoders, which must keep their size.
+		Options = Options->Clone();
+		if (!ReopenEncoder(width, height))
+		{
+			if (ReopenEncoder(oldWidth, oldHeight))
+				throw gcnew Exception("x264_encoder_open failed at " + width + " x " + height + ". The encoder continues at " + oldWidth + " x " + oldHeight + ".");
+			DisposeLocked();
+			throw gcnew Exception("x264_encoder_open failed at " + width + " x " + height + ", and the encoder could not be reopened at " + oldWidth + " x " + oldHeight + ". This X264Net has been disposed.");
+		}
+
+		// The previous frame's hash is of a different size, and the cached GOP can no longer be decoded with the new parameter sets.
+		hasPreviousFrame = false;
+		// x264 reopened with the original VBV, so the multiplexer's allocation is reapplied before the next frame.
+		MultiplexMember^ member = multiplexMember;
+		if (member != nullptr)
+			member->applied = param->rc.i_vbv_max_bitrate;
+		if (speedControl)
+		{
+			delete speedControl;
+			speedControl = NULL;
+			x264_param_t opened;
+			x264_encoder_parameters(encoder, &opened);
+			speedControl = new SpeedControl(opened, Options->AdaptiveSpeedTargetLoad * Options->FPSDenominator / Options->FPS);
+		}
+		if (gopCache)
+		{
+			gopCache->Clear();
+			x264_nal_t* headerNals;
+			int i_headerNals;
+			int headerSize = x264_encoder_headers(encoder, &headerNals, &i_headerNals);
+			if (headerSize > 0)
+				gopCache->SetHeaders(headerNals[0].p_payload, headerSize);
+		}
+		return flushed;
+	}
+	/// <summary>
+	/// <para>Closes x264 and opens it again with the same parameters at another size, swapping the input pictures for ones of that size.  Returns false if x264_encoder_open failed, leaving no encoder open.</para>
+	/// </summary>
+	bool X264Net::ReopenEncoder(int width, int height)
+	{
+		if (encoder)
+			x264_encoder_close(encoder);
+		encoder = NULL;
+		ReleaseInputs();
+		Options->Width = width;
+		Options->Height = height;
+		param->i_width = width;
+		param->i_height = height;
+		AllocateInputs();
+		if (constantMbInfo)
+		{
+			delete[] constantMbInfo;
+			constantMbInfo = NULL;
+			int mbCount = ((width + 15) / 16) * ((height + 15) / 16);
+			constantMbInfo = new uint8_t[mbCount];
+			memset(constantMbInfo, X264_MBINFO_CONSTANT, mbCount);
+		}
+		encoder = x264_encoder_open(param);
+		return encoder != NULL;
+	}
+	/// <summary>
+	/// <para>Calls x264_encoder_encode, shares the output with the GOP cache and broadcaster, and returns the FrameRecord of the frame that was output (or NULL if none was), with its encode times filled in.  The caller must pass the record to TakeOutput.</para>
+	/// </summary>
+	FrameRecord* X264Net::EncodePicture(x264_picture_t* picture, x264_nal_t** nals, int* i_nals)
+	{
+		int64_t started = System::Diagnostics::Stopwatch::GetTimestamp();
+		if (picture && picture->opaque)
+			((FrameRecord*)picture->opaque)->queued = started;
+		if (multiplexMember != nullptr)
+			ApplyMultiplexer();
+		int frame_size = x264_encoder_encode(encoder, nals, i_nals, picture, pic_out);
+		if (frame_size < 0)
+			throw gcnew Exception("x264_encoder_encode failed with return value " + frame_size);
+		// With OverlapConversion this runs alongside the conversion of the next frame, so label spans with this picture's pts, not tracePts.
+		int64_t pts = picture ? picture->i_pts : -1;
+		if (traceRing)
+			Trace(TraceStageEncode, started, pts);
+		FrameRecord* record = frame_size > 0 ? (FrameRecord*)pic_out->opaque : NULL;
+		if (record)
+		{
+			record->encodeStarted = started;
+			record->encodeFinished = System::Diagnostics::Stopwatch::GetTimestamp();
+		}
+		if (multiplexMember != nullptr && frame_size > 0)
+			UpdateMultiplexer(frame_size);
+		if ((gopCache || broadcastRing) && frame_size > 0)
 		{
-			// Copy encoded frame into managed array(s)
-			if (eachNalGetsOwnArray)
+			int64_t publishStart = traceRing ? System::Diagnostics::Stopwatch::GetTimestamp() : 0;
+			// One immutable copy of the frame is shared by the GOP cache and every subscriber.
+			EncodedBuffer* buffer = EncodedBuffer::Create(*nals, *i_nals, frame_size, pic_out, bufferPool);
+			if (buffer)
 			{
-				array<array<Byte>^>^ managed_NAL_array = gcnew array<array<Byte>^>(i_nals);
+				if (gopCache)
+					gopCache->Add(buffer);
+				if (broadcastRing)
+					broadcastRing->Publish(buffer);
+				buffer->Release();
+			}
+			if (traceRing)
+				Trace(TraceStagePublish, publishStart, pts);
+		}
+		return record;
+	}
+	/// <summary>
+	/// <para>Copies the output of one x264_encoder_encode call into the requested managed form and recycles its FrameRecord.</para>
+	/// </summary>
+	Object^ X264Net::TakeOutput(FrameRecord* record, x264_nal_t* nals, int i_nals, EncodeOutput output)
+	{
+		Object^ result = nullptr;
+		int64_t copyStart = traceRing && i_nals > 0 ? System::Diagnostics::Stopwatch::GetTimestamp() : 0;
+		try
+		{
+			if (output == EncodeOutput::Append)
+			{
+				// x264 guarantees that the payloads of all output NALs are sequential in memory.
+				int size = 0;
+				for (int i = 0; i < i_nals; i++)
+					size += nals[i].i_payload;
+				if (size > 0)
+					appendTarget->insert(appendTarget->end(), nals[0].p_payload, nals[0].p_payload + size);
+			}
+			else if (output == EncodeOutput::Channel)
+			{
+				int size = 0;
 				for (int i = 0; i < i_nals; i++)
+					size += nals[i].i_payload;
+				if (size > 0)
 				{
-					array<Byte>^ managed_NAL = gcnew array<Byte>(nals[i].i_payload);
-					System::Runtime::InteropServices::Marshal::Copy((IntPtr)nals[i].p_payload, managed_NAL, 0, nals[i].i_payload);
-					managed_NAL_array[i] = managed_NAL;
+					if (!outputChannel->OutputFits(size))
+						throw gcnew Exception("The encoded frame (" + size + " bytes) does not fit in the output ring.");
+					while (!outputChannel->TryWriteOutput(nals[0].p_payload, size, 0, outputFrame))
+					{
+						if (!waitForOutputSpace())
+							throw gcnew OperationCanceledException("The output ring has no reader.");
+					}
+					outputWritten = true;
 				}
-				return managed_NAL_array;
 			}
-			else
+			else if (output != EncodeOutput::Tracked)
+				result = CopyOutput(nals, i_nals, output);
+			else if (record)
+				result = gcnew EncodedFrameInfo((array<Byte>^)CopyOutput(nals, i_nals, EncodeOutput::WholeArray), record, pic_out->i_pts, pic_out->i_dts, pic_out->b_keyframe != 0);
+		}
+		finally
+		{
+			if (record)
+				recordPool->Return(record);
+		}
+		if (copyStart)
+			Trace(TraceStageCopyOut, copyStart);
+		return result;
+	}
+	Object^ X264Net::CopyOutput(x264_nal_t* nals, int i_nals, EncodeOutput output)
+	{
+		// Copy encoded frame into managed array(s)
+		if (output == EncodeOutput::None)
+			return nullptr;
+		else if (output == EncodeOutput::NalArrays)
+		{
+			array<array<Byte>^>^ managed_NAL_array = gcnew array<array<Byte>^>(i_nals);
+			for (int i = 0; i < i_nals; i++)
+			{
+				array<Byte>^ managed_NAL = gcnew array<Byte>(nals[i].i_payload);
+				System::Runtime::InteropServices::Marshal::Copy((IntPtr)nals[i].p_payload, managed_NAL, 0, nals[i].i_payload);
+				managed_NAL_array[i] = managed_NAL;
+			}
+			return managed_NAL_array;
+		}
+		else
+		{
+			int totalDataSize = 0;
+			for (int i = 0; i < i_nals; i++)
+				totalDataSize += nals[i].i_payload;
+			array<Byte>^ managed_NAL_array = gcnew array<Byte>(totalDataSize);
+			int copiedSoFar = 0;
+			for (int i = 0; i < i_nals; i++)
+			{
+				System::Runtime::InteropServices::Marshal::Copy((IntPtr)nals[i].p_payload, managed_NAL_array, copiedSoFar, nals[i].i_payload);
+				copiedSoFar += nals[i].i_payload;
+			}
+			return managed_NAL_array;
+		}
+	}
+	/// <summary>
+	/// <para>Returns the H.264 data a newly joined viewer needs in order to start decoding immediately: the SPS and PPS followed by every frame encoded since the most recent keyframe (an IDR frame, or the start of an intra refresh).</para>
+	/// <para>Feed this to the new viewer's decoder, then continue with the output of subsequent EncodeFrame calls.  No extra frames are encoded and no keyframe is forced.</para>
+	/// <para>Returns null if EnableGopCache was not set, if no keyframe has been encoded yet, or if the current GOP has outgrown GopCacheMaxFrames.</para>
+	/// <para>This method may be called from any thread.</para>
+	/// </summary>
+	array<Byte>^ X264Net::JoinSnapshot()
+	{
+		// Dispose waits for this, so the GOP cache cannot be freed while it is read.
+		System::Threading::Monitor::Enter(disposeLock);
+		try
+		{
+			if (isDisposed)
+				throw gcnew ObjectDisposedException("X264Net");
+			if (!gopCache)
+				return nullptr;
+
+			std::vector<EncodedBuffer*> buffers;
+			if (!gopCache->Snapshot(buffers))
+				return nullptr;
+			try
 			{
 				int totalDataSize = 0;
-				for (int i = 0; i < i_nals; i++)
-					totalDataSize += nals[i].i_payload;
-				array<Byte>^ managed_NAL_array = gcnew array<Byte>(totalDataSize);
+				for (size_t i = 0; i < buffers.size(); i++)
+					totalDataSize += buffers[i]->size;
+				array<Byte>^ snapshot = gcnew array<Byte>(totalDataSize);
 				int copiedSoFar = 0;
-				for (int i = 0; i < i_nals; i++)
+				for (size_t i = 0; i < buffers.size(); i++)
 				{
-					System::Runtime::InteropServices::Marshal::Copy((IntPtr)nals[i].p_payload, managed_NAL_array, copiedSoFar, nals[i].i_payload);
-					copiedSoFar += nals[i].i_payload;
+					System::Runtime::InteropServices::Marshal::Copy((IntPtr)buffers[i]->data, snapshot, copiedSoFar, buffers[i]->size);
+					copiedSoFar += buffers[i]->size;
 				}
-				return managed_NAL_array;
+				return snapshot;
+			}
+			finally
+			{
+				for (size_t i = 0; i < buffers.size(); i++)
+					buffers[i]->Release();
 			}
 		}
-		else
-			throw gcnew Exception("x264_encoder_encode failed with return value " + frame_size);
+		finally
+		{
+			System::Threading::Monitor::Exit(disposeLock);
+		}
+	}
+	void X264Net::AttachBroadcastRing(BroadcastRing* ring)
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("X264Net");
+		if (broadcastRing)
+			throw gcnew InvalidOperationException("A FrameBroadcaster is already attached to this encoder");
+		ring->AddRef();
+		broadcastRing = ring;
+	}
+	void X264Net::DetachBroadcastRing(BroadcastRing* ring)
+	{
+		if (isDisposed || broadcastRing != ring)
+			return;
+		broadcastRing = NULL;
+		ring->Release();
+	}
+	int X264Net::SpeedLevel::get()
+	{
+		return speedControl ? speedControl->Level() : -1;
+	}
+	Int64 X264Net::DuplicateFrameCount::get()
+	{
+		return duplicateFrameCount;
+	}
+	/// <summary>
+	/// <para>Returns the events recorded since tracing began (or the most recent TraceCapacity events) as a Chrome trace-event JSON document.  Save it to a .json file and open it in chrome://tracing or https://ui.perfetto.dev to see where each frame's time went.</para>
+	/// <para>Returns null if EnableTracing was not set.  This method may be called from any thread.</para>
+	/// </summary>
+	String^ X264Net::ExportTrace()
+	{
+		// Dispose waits for this, so the trace ring cannot be freed while it is read.
+		System::Threading::Monitor::Enter(disposeLock);
+		try
+		{
+			if (isDisposed)
+				throw gcnew ObjectDisposedException("X264Net");
+			if (!traceRing)
+				return nullptr;
+			return getSystemString(traceRing->Export(System::Diagnostics::Stopwatch::Frequency, System::Diagnostics::Process::GetCurrentProcess()->Id));
+		}
+		finally
+		{
+			System::Threading::Monitor::Exit(disposeLock);
+		}
+	}
+	void X264Net::Trace(TraceStage stage, int64_t begin)
+	{
+		Trace(stage, begin, tracePts);
+	}
+	void X264Net::Trace(TraceStage stage, int64_t begin, int64_t pts)
+	{
+		traceRing->Add(stage, begin, System::Diagnostics::Stopwatch::GetTimestamp(), pts, System::Threading::Thread::CurrentThread->ManagedThreadId);
+	}
+	void X264Net::TraceFrame(int64_t begin)
+	{
+		TraceFrame(begin, tracePts);
+	}
+	void X264Net::TraceFrame(int64_t begin, int64_t pts)
+	{
+		Trace(TraceStageFrame, begin, pts);
+		// Collections that ran during the frame show up as gaps between its stages; mark them so they are not mistaken for encoder time.
+		int gcCount = GC::CollectionCount(0);
+		if (gcCount != traceGcCount)
+		{
+			int64_t now = System::Diagnostics::Stopwatch::GetTimestamp();
+			traceRing->Add(TraceStageGarbageCollection, now, now, pts, System::Threading::Thread::CurrentThread->ManagedThreadId);
+			traceGcCount = gcCount;
+		}
+	}
+	/// <summary>
+	/// <para>Attaches a user data unregistered SEI message (payload type 5) to the next frame submitted to the encoder, so metadata such as a capture wall-clock time travels in-band with that frame.  May be called several times before a frame to attach several messages.</para>
+	/// <para>The message consists of uuid, written in RFC 4122 (big-endian) byte order as the SEI's uuid_iso_iec_11578, followed by data.  If the next frame is dropped as a duplicate, the messages go with the frame after it.</para>
+	/// </summary>
+	/// <param name="uuid">Identifies the kind of data, so that readers can recognize their own messages.</param>
+	/// <param name="data">The message body.</param>
+	void X264Net::AttachUserData(Guid uuid, array<Byte>^ data)
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("X264Net");
+		if (data == nullptr)
+			throw gcnew ArgumentNullException("data");
+
+		array<Byte>^ guidBytes = uuid.ToByteArray();
+		int size = 16 + data->Length;
+		EncodedBuffer* buffer = bufferPool->Acquire(size);
+		if (!buffer)
+			throw gcnew OutOfMemoryException("Unable to allocate a " + size + " byte SEI payload");
+		// Guid.ToByteArray() stores the first three fields little-endian.
+		static const int order[16] = { 3, 2, 1, 0, 5, 4, 7, 6, 8, 9, 10, 11, 12, 13, 14, 15 };
+		for (int i = 0; i < 16; i++)
+			buffer->data[i] = guidBytes[order[i]];
+		if (data->Length > 0)
+			System::Runtime::InteropServices::Marshal::Copy(data, 0, (IntPtr)(buffer->data + 16), data->Length);
+		buffer->size = size;
+
+		x264_sei_payload_t payload;
+		payload.payload_size = size;
+		payload.payload_type = 5; // user_data_unregistered
+		payload.payload = buffer->data;
+		pendingSei->push_back(payload);
+	}
+	/// <summary>
+	/// <para>Hands the pending SEI messages to pic_in.  The payloads and the array describing them are pooled buffers, which x264 returns to the pool through sei_free once they are written.</para>
+	/// </summary>
+	void X264Net::AttachPendingSei()
+	{
+		if (pendingSei->empty())
+			return;
+		int count = (int)pendingSei->size();
+		EncodedBuffer* payloads = bufferPool->Acquire(count * sizeof(x264_sei_payload_t));
+		if (!payloads)
+			throw gcnew OutOfMemoryException("Unable to allocate the SEI payload list");
+		memcpy(payloads->data, &(*pendingSei)[0], count * sizeof(x264_sei_payload_t));
+		pendingSei->clear();
+		pic_in->extra_sei.num_payloads = count;
+		pic_in->extra_sei.payloads = (x264_sei_payload_t*)payloads->data;
+		pic_in->extra_sei.sei_free = &EncodedBuffer::ReleaseData;
+	}
+	void X264Net::ReleasePendingSei()
+	{
+		for (size_t i = 0; i < pendingSei->size(); i++)
+			EncodedBuffer::ReleaseData((*pendingSei)[i].payload);
+		pendingSei->clear();
+	}
+	/// <summary>
+	/// <para>Applies Options->ParamOverrides to param with x264_param_parse, throwing one exception which lists every entry that was rejected.</para>
+	/// </summary>
+	void X264Net::ApplyParamOverrides()
+	{
+		if (Options->ParamOverrides == nullptr)
+			return;
+		System::Text::StringBuilder^ errors = gcnew System::Text::StringBuilder();
+		for each (System::Collections::Generic::KeyValuePair<String^, String^> entry in Options->ParamOverrides)
+		{
+			if (String::IsNullOrEmpty(entry.Key))
+			{
+				errors->Append(Environment::NewLine + "(empty name): a parameter name is required");
+				continue;
+			}
+			std::string name = getStdString(entry.Key);
+			std::string value = entry.Value == nullptr ? std::string() : getStdString(entry.Value);
+			int result = x264_param_parse(param, name.c_str(), entry.Value == nullptr ? NULL : value.c_str());
+			if (result == X264_PARAM_BAD_NAME)
+				errors->Append(Environment::NewLine + entry.Key + ": unknown parameter name");
+			else if (result == X264_PARAM_BAD_VALUE)
+				errors->Append(Environment::NewLine + entry.Key + ": invalid value " + (entry.Value == nullptr ? "(null)" : "\"" + entry.Value + "\""));
+			else if (result != 0)
+				errors->Append(Environment::NewLine + entry.Key + ": x264_param_parse failed with code " + result);
+		}
+		if (errors->Length > 0)
+			throw gcnew ArgumentException("One or more ParamOverrides were rejected:" + errors->ToString(), "ParamOverrides");
+	}
+	/// <summary>
+	/// <para>Returns the parameters the encoder is actually using (as reported by x264_encoder_parameters, after x264 has validated and adjusted them), keyed by their x264 command line names.  Use this to check the effect of Preset, Tune, Profile, ParamOverrides, and AdaptiveSpeed.</para>
+	/// </summary>
+	System::Collections::Generic::Dictionary<String^, String^>^ X264Net::GetEffectiveParameters()
+	{
+		if (isDisposed)
+			throw gcnew ObjectDisposedException("X264Net");
+		JoinPendingEncode();
+		x264_param_t p;
+		x264_encoder_parameters(encoder, &p);
+		System::Collections::Generic::Dictionary<String^, String^>^ result = gcnew System::Collections::Generic::Dictionary<String^, String^>();
+		result["threads"] = p.i_threads.ToString();
+		result["lookahead-threads"] = p.i_lookahead_threads.ToString();
+		result["sliced-threads"] = p.b_sliced_threads.ToString();
+		result["sync-lookahead"] = p.i_sync_lookahead.ToString();
+		result["deterministic"] = p.b_deterministic.ToString();
+		result["width"] = p.i_width.ToString();
+		result["height"] = p.i_height.ToString();
+		result["level"] = p.i_level_idc.ToString();
+		result["fps"] = p.i_fps_num.ToString() + "/" + p.i_fps_den;
+		result["timebase"] = p.i_timebase_num.ToString() + "/" + p.i_timebase_den;
+		result["vfr-input"] = p.b_vfr_input.ToString();
+		result["keyint"] = p.i_keyint_max.ToString();
+		result["min-keyint"] = p.i_keyint_min.ToString();
+		result["scenecut"] = p.i_scenecut_threshold.ToString();
+		result["intra-refresh"] = p.b_intra_refresh.ToString();
+		result["bframes"] = p.i_bframe.ToString();
+		result["b-adapt"] = p.i_bframe_adaptive.ToString();
+		result["ref"] = p.i_frame_reference.ToString();
+		result["cabac"] = p.b_cabac.ToString();
+		result["deblock"] = p.b_deblocking_filter.ToString();
+		result["8x8dct"] = p.analyse.b_transform_8x8.ToString();
+		result["weightp"] = p.analyse.i_weighted_pred.ToString();
+		result["weightb"] = p.analyse.b_weighted_bipred.ToString();
+		result["me"] = p.analyse.i_me_method.ToString();
+		result["merange"] = p.analyse.i_me_range.ToString();
+		result["subme"] = p.analyse.i_subpel_refine.ToString();
+		result["trellis"] = p.analyse.i_trellis.ToString();
+		result["mixed-refs"] = p.analyse.b_mixed_references.ToString();
+		result["partitions"] = "0x" + p.analyse.inter.ToString("x");
+		result["rc-method"] = p.rc.i_rc_method == X264_RC_CRF ? "crf" : (p.rc.i_rc_method == X264_RC_ABR ? "abr" : "cqp");
+		result["crf"] = p.rc.f_rf_constant.ToString(System::Globalization::CultureInfo::InvariantCulture);
+		result["crf-max"] = p.rc.f_rf_constant_max.ToString(System::Globalization::CultureInfo::InvariantCulture);
+		result["bitrate"] = p.rc.i_bitrate.ToString();
+		result["vbv-maxrate"] = p.rc.i_vbv_max_bitrate.ToString();
+		result["vbv-bufsize"] = p.rc.i_vbv_buffer_size.ToString();
+		result["qpmin"] = p.rc.i_qp_min.ToString();
+		result["qpmax"] = p.rc.i_qp_max.ToString();
+		result["aq-mode"] = p.rc.i_aq_mode.ToString();
+		result["mbtree"] = p.rc.b_mb_tree.ToString();
+		result["rc-lookahead"] = p.rc.i_lookahead.ToString();
+		result["repeat-headers"] = p.b_repeat_headers.ToString();
+		result["annexb"] = p.b_annexb.ToString();
+		return result;
 	}
 }
\ No newline at end of file
@@ -4,11 +4,24 @@
 #include "stdint.h"
 #include "lib/x264/include/x264.h"
 #include "X264Options.h"
+#include "GopCache.h"
+#include "BroadcastRing.h"
+#include "RGB_To_YUV420.h"
+#include "FrameHash.h"
+#include "EncodedFrameInfo.h"
+#include "TraceRing.h"
+#include "SpeedControl.h"
+#include "OsdOverlay.h"
+#include "PicturePool.h"
+#include "BitrateMultiplexer.h"
+#include "HostChannel.h"
 
 using namespace System;
 
 namespace x264net {
 
+	enum class EncodeOutput { NalArrays, WholeArray, None, Tracked, Append, Channel };
+
 	/// <summary>
 	/// X264Net, a .NET wrapper for x264.  Each instance must be disposed when you are finished with it.
 	/// </summary>
@@ -19,18 +32,143 @@ namespace x264net {
 		x264_t* encoder;
 		x264_picture_t* pic_in;
 		x264_picture_t* pic_out;
+		x264_picture_t* spareInput;
+		bool spareChromaNeutral;
+		PicturePool* picturePool;
+		System::Threading::Tasks::Task^ pendingEncode;
+		x264_picture_t* submittedInput;
+		FrameRecord* pendingRecord;
+		x264_nal_t* pendingNals;
+		int pendingNalCount;
+		int64_t pendingStart;
+		int64_t pendingConvertTicks;
+		int64_t pendingEncodeTicks;
 		int64_t frame;
+		int64_t frameDuration;
+		int64_t lastPts;
+		int64_t firstPts;
+		bool stitchable;
+		char* statsFile;
+		RgbToYuv420Function convertRgb;
+		bool interleavedChroma;
+		GrayToLumaFunction convertGray;
+		uint8_t* grayToLuma;
+		bool grayscaleInput;
+		bool chromaNeutral;
+		GopCache* gopCache;
+		EncodedBufferPool* bufferPool;
+		BroadcastRing* broadcastRing;
+		SpeedControl* speedControl;
+		uint8_t* constantMbInfo;
+		uint64_t previousHash;
+		bool hasPreviousFrame;
+		int64_t duplicateFrameCount;
+		FrameRecordPool* recordPool;
+		TraceRing* traceRing;
+		int64_t tracePts;
+		int traceGcCount;
+		std::vector<x264_sei_payload_t>* pendingSei;
+		std::vector<uint8_t>* appendTarget;
 
 		bool isDisposed;
+		/// <summary>
+		/// <para>Held by methods that may be called from any thread while they read native state, and by Dispose while it frees that state.</para>
+		/// </summary>
+		Object^ disposeLock;
 		!X264Net();
+		void DisposeLocked();
 		void Initialize();
-		Object^ EncodeFrame_Internal(array<Byte>^ rgb_data, bool eachNalGetsOwnArray);
+		void AllocateInputs();
+		void ReleaseInputs();
+		bool ReopenEncoder(int width, int height);
+		Object^ EncodeFrame_Internal(array<Byte>^ rgb_data, int64_t pts, int64_t token, EncodeOutput output);
+		int64_t BeginFrame(int64_t pts);
+		Object^ FinishFrame(int64_t startTime, int64_t token, EncodeOutput output);
+		FrameRecord* EncodePicture(x264_picture_t* picture, x264_nal_t** nals, int* i_nals);
+		FrameRecord* SubmitPicture(x264_picture_t* picture, x264_nal_t** nals, int* i_nals);
+		void UpdateSpeedControl(double seconds);
+		void UpdateMultiplexer(int frameSize);
+		void ApplyMultiplexer();
+		void ApplyMultiplexedRate(x264_param_t* tuned, int rate);
+		Object^ FinishFrameOverlapped(int64_t startTime, EncodeOutput output);
+		void EncodeSubmitted();
+		void JoinPendingEncode();
+		Object^ TakePendingOutput(EncodeOutput output);
+		void ReuseSubmittedInput();
+		void SwapInputs();
+		Object^ TakeOutput(FrameRecord* record, x264_nal_t* nals, int i_nals, EncodeOutput output);
+		void ApplyParamOverrides();
+		void AttachPendingSei();
+		void ReleasePendingSei();
+		void Trace(TraceStage stage, int64_t begin);
+		void Trace(TraceStage stage, int64_t begin, int64_t pts);
+		void TraceFrame(int64_t begin);
+		void TraceFrame(int64_t begin, int64_t pts);
+		uint64_t OverlayState();
+		void BlendOverlays();
+		void SetGrayscaleInput(bool gray);
+		static array<Byte>^ TakeAppended(std::vector<uint8_t>& appended, std::vector<int>& ends, array<int>^% offsets);
+		static Object^ CopyOutput(x264_nal_t* nals, int i_nals, EncodeOutput output);
+	internal:
+		X264Net(X264Options^ options, bool stitchable, int64_t firstPts);
+		Object^ EncodeImage(const uint8_t* rgb, int rgbStride, int64_t pts, int64_t token, EncodeOutput output);
+		Object^ EncodeInputPicture(int64_t pts, int64_t token, EncodeOutput output);
+		property int64_t NextTimestamp { int64_t get() { return frame; } }
+		property x264_picture_t* InputPicture { x264_picture_t* get() { return pic_in; } }
+		property EncodedBufferPool* BufferPool { EncodedBufferPool* get() { return bufferPool; } }
+		void AttachBroadcastRing(BroadcastRing* ring);
+		void DetachBroadcastRing(BroadcastRing* ring);
+		/// <summary>
+		/// <para>This encoder's share of a BitrateMultiplexer, or null.  Set by BitrateMultiplexer.Join and Leave.</para>
+		/// </summary>
+		MultiplexMember^ multiplexMember;
+		/// <summary>
+		/// <para>True if a MosaicEncoder owns this encoder, whose regions depend on the picture size.</para>
+		/// </summary>
+		bool ownedByMosaic;
+		/// <summary>
+		/// <para>With EncodeOutput::Channel, output is written straight into this ring as a record answering input slot outputFrame, and outputWritten is set.  waitForOutputSpace is called while the ring is full and returns false to give up.</para>
+		/// </summary>
+		HostChannel* outputChannel;
+		int64_t outputFrame;
+		bool outputWritten;
+		Func<bool>^ waitForOutputSpace;
 	public:
 		X264Options^ Options;
+		/// <summary>
+		/// <para>Text drawn into every frame after color conversion, e.g. a timestamp and camera label.  Empty by default.  The list may be changed between frames.</para>
+		/// </summary>
+		System::Collections::Generic::List<OsdOverlay^>^ Overlays;
 
 		X264Net(X264Options^ options);
 		~X264Net();
 		array<array<Byte>^>^ EncodeFrame(array<Byte>^ rgb_data);
+		array<array<Byte>^>^ EncodeFrame(array<Byte>^ rgb_data, Int64 timestamp);
 		array<Byte>^ EncodeFrameAsWholeArray(array<Byte>^ rgb_data);
+		array<Byte>^ EncodeFrameAsWholeArray(array<Byte>^ rgb_data, Int64 timestamp);
+		array<Byte>^ EncodeFrameAsWholeArray(IntPtr data, int stride);
+		array<Byte>^ EncodeFrameAsWholeArray(IntPtr data, int stride, Int64 timestamp);
+		array<Byte>^ EncodeFrames(array<Byte>^ frames, int frameCount, [System::Runtime::InteropServices::Out] array<int>^% offsets);
+		array<Byte>^ EncodeFrames(array<Byte>^ frames, int frameCount, array<Int64>^ timestamps, [System::Runtime::InteropServices::Out] array<int>^% offsets);
+		static array<Byte>^ EncodeFrames(array<X264Net^>^ encoders, array<array<Byte>^>^ frames, [System::Runtime::InteropServices::Out] array<int>^% offsets);
+		void PublishFrame(array<Byte>^ rgb_data);
+		void PublishFrame(array<Byte>^ rgb_data, Int64 timestamp);
+		EncodedFrameInfo^ EncodeFrameTracked(array<Byte>^ rgb_data, Int64 token);
+		EncodedFrameInfo^ EncodeFrameTracked(array<Byte>^ rgb_data, Int64 timestamp, Int64 token);
+		array<Byte>^ Flush();
+		array<EncodedFrameInfo^>^ FlushTracked();
+		array<Byte>^ Resize(int width, int height);
+		String^ ExportTrace();
+		void AttachUserData(Guid uuid, array<Byte>^ data);
+		System::Collections::Generic::Dictionary<String^, String^>^ GetEffectiveParameters();
+		array<Byte>^ JoinSnapshot();
+		/// <summary>
+		/// <para>When AdaptiveSpeed is enabled, the current speed level, from 0 (fastest) up to the level matching the original Preset.  -1 if AdaptiveSpeed is disabled.</para>
+		/// </summary>
+		property int SpeedLevel { int get(); }
+		/// <summary>
+		/// <para>The number of input frames recognized as duplicates of the previous frame (see X264Options.DuplicateFrames).</para>
+		/// </summary>
+		property Int64 DuplicateFrameCount { Int64 get(); }
 	};
 }